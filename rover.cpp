@@ -1,433 +1,7562 @@
 #define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
 #include "catch.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-// Represents a 2x2 grid of the planet
-class Grid {
-public:
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define ROVER_X86_KERNELS 1
+#endif
 
-  /**
-   * Constructs a Grid object
-   *
-   * This object keeps track of what obstacles are currently on the grid.
-   * This object also handles wrapping around the planet
-   **/
-  Grid(int numRows, int numCols) {
-    this->obstacleMap.assign(numRows, std::vector<bool>(numCols, true));
+/**
+ * Marks an API kept only for existing callers, so using it draws a compiler warning
+ **/
+#if defined(__GNUC__) || defined(__clang__)
+#define ROVER_DEPRECATED(message) __attribute__((deprecated(message)))
+#else
+#define ROVER_DEPRECATED(message)
+#endif
+
+/**
+ * BIT SCANNING HELPERS
+ **/
+
+/**
+ * Index of the lowest set bit of a non-zero word
+ **/
+inline int countTrailingZeros(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(word);
+#else
+  int count = 0;
+  while ((word & 1) == 0) {
+    word >>= 1;
+    count++;
+  }
+  return count;
+#endif
+}
+
+/**
+ * Number of zero bits above the highest set bit of a non-zero word
+ **/
+inline int countLeadingZeros(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_clzll(word);
+#else
+  int count = 0;
+  while ((word & ((uint64_t) 1 << 63)) == 0) {
+    word <<= 1;
+    count++;
+  }
+  return count;
+#endif
+}
+
+/**
+ * Number of set bits in a word
+ **/
+inline int countSetBits(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(word);
+#else
+  int count = 0;
+  for (; word != 0; word &= word - 1) {
+    count++;
+  }
+  return count;
+#endif
+}
+
+/**
+ * Mirrors the bits within each byte of a word, leaving the bytes in place
+ * Converts between most-significant-bit-first bitmaps (such as PBM) and the grid's bit order
+ **/
+inline uint64_t reverseBitsInEachByte(uint64_t word) {
+  word = ((word >> 1) & 0x5555555555555555ull) | ((word & 0x5555555555555555ull) << 1);
+  word = ((word >> 2) & 0x3333333333333333ull) | ((word & 0x3333333333333333ull) << 2);
+  return ((word >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((word & 0x0F0F0F0F0F0F0F0Full) << 4);
+}
+
+/**
+ * Swaps the off-diagonal width x width sub-blocks of every 2width x 2width block
+ * A compile-time width gives fixed inner loops that the compiler unrolls and vectorises
+ **/
+template <int width>
+inline void swapBitSubBlocks(uint64_t block[64], uint64_t mask) {
+  for (int first = 0; first < 64; first += 2 * width) {
+    for (int i = first; i < first + width; i++) {
+      uint64_t swapped = ((block[i] >> width) ^ block[i + width]) & mask;
+      block[i] ^= swapped << width;
+      block[i + width] ^= swapped;
+    }
+  }
+}
+
+/**
+ * Transposes a 64x64 block of bits in place: bit j of word i moves to bit i of word j
+ **/
+inline void transposeBitBlock(uint64_t block[64]) {
+  swapBitSubBlocks<32>(block, 0x00000000FFFFFFFFull);
+  swapBitSubBlocks<16>(block, 0x0000FFFF0000FFFFull);
+  swapBitSubBlocks<8>(block, 0x00FF00FF00FF00FFull);
+  swapBitSubBlocks<4>(block, 0x0F0F0F0F0F0F0F0Full);
+  swapBitSubBlocks<2>(block, 0x3333333333333333ull);
+  swapBitSubBlocks<1>(block, 0x5555555555555555ull);
+}
+
+/**
+ * Sets bits first .. last (inclusive) of a bitset, a whole word at a time
+ * Returns how many of them were clear before
+ **/
+inline size_t setBitRange(uint64_t* words, int first, int last) {
+  size_t numSet = 0;
+  int firstWord = first / 64;
+  int lastWord = last / 64;
+  for (int i = firstWord; i <= lastWord; i++) {
+    uint64_t mask = ~(uint64_t) 0;
+    if (i == firstWord) {
+      mask &= ~(uint64_t) 0 << (first % 64);
+    }
+    if (i == lastWord) {
+      mask &= ~(uint64_t) 0 >> (63 - last % 64);
+    }
+    numSet += countSetBits(mask & ~words[i]);
+    words[i] |= mask;
+  }
+  return numSet;
+}
+
+/**
+ * Finds the first set bit in positions [from, to) of a bitset
+ * words can be a pointer or anything else that yields the i-th word with words[i]
+ * Returns -1 if none of those bits are set
+ **/
+template <typename Words>
+int findFirstSetBit(const Words& words, int from, int to) {
+  if (from >= to) {
+    return -1;
+  }
+  int firstWord = from / 64;
+  int lastWord = (to - 1) / 64;
+  for (int i = firstWord; i <= lastWord; i++) {
+    uint64_t word = words[i];
+    if (i == firstWord) {
+      word &= ~(uint64_t) 0 << (from % 64);
+    }
+    if (i == lastWord && to % 64 != 0) {
+      word &= ~(~(uint64_t) 0 << (to % 64));
+    }
+    if (word != 0) {
+      return i * 64 + countTrailingZeros(word);
+    }
+  }
+  return -1;
+}
+
+/**
+ * Finds the last set bit in positions [from, to) of a bitset
+ * Returns -1 if none of those bits are set
+ **/
+template <typename Words>
+int findLastSetBit(const Words& words, int from, int to) {
+  if (from >= to) {
+    return -1;
+  }
+  int firstWord = from / 64;
+  int lastWord = (to - 1) / 64;
+  for (int i = lastWord; i >= firstWord; i--) {
+    uint64_t word = words[i];
+    if (i == firstWord) {
+      word &= ~(uint64_t) 0 << (from % 64);
+    }
+    if (i == lastWord && to % 64 != 0) {
+      word &= ~(~(uint64_t) 0 << (to % 64));
+    }
+    if (word != 0) {
+      return i * 64 + 63 - countLeadingZeros(word);
+    }
   }
+  return -1;
+}
+
+/**
+ * Counts how many cells a rover at position start of a wrapped line of cells
+ * can travel before the next cell would be an obstacle. Only the cells within
+ * maxSteps of start are looked at; maxSteps is returned if none are blocked
+ **/
+template <typename Words>
+size_t freeRunAlongLine(const Words& line, int length, int start, bool increasing, size_t maxSteps) {
+  int span = maxSteps < (size_t) length ? (int) maxSteps : length;
+  int distance = -1;
+  if (increasing) {
+    // Cells start+1 .. start+span, wrapping past the end of the line
+    int obstacle = findFirstSetBit(line, start + 1, std::min(length, start + 1 + span));
+    if (obstacle >= 0) {
+      distance = obstacle - start;
+    } else if (start + span >= length) {
+      obstacle = findFirstSetBit(line, 0, start + span - length + 1);
+      if (obstacle >= 0) {
+        distance = obstacle + length - start;
+      }
+    }
+  } else {
+    // Cells start-1 .. start-span, wrapping past the beginning of the line
+    int obstacle = findLastSetBit(line, std::max(0, start - span), start);
+    if (obstacle >= 0) {
+      distance = start - obstacle;
+    } else if (start - span < 0) {
+      obstacle = findLastSetBit(line, start - span + length, length);
+      if (obstacle >= 0) {
+        distance = start + length - obstacle;
+      }
+    }
+  }
+  return distance < 0 ? maxSteps : (size_t) distance - 1;
+}
+
+/**
+ * Runs task(0) .. task(numTasks - 1), each on its own thread
+ * The calling thread runs task 0 and returns once every task has finished
+ **/
+template <typename Task>
+void runInParallel(size_t numTasks, const Task& task) {
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < numTasks; i++) {
+    threads.push_back(std::thread([&task, i]() { task(i); }));
+  }
+  if (numTasks > 0) {
+    task(0);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
 
+/**
+ * Tracks which cells of a grid are currently taken by rovers
+ *
+ * Every cell has two atomic words: the id of the rover holding it (0 when
+ * free) and a reservation word used to settle simultaneous moves. Cells are
+ * claimed and released with compare-and-swap, so rovers moving on different
+ * threads share the layer without any lock, and every operation is O(1)
+ * however many rovers are on the planet.
+ *
+ * The words are kept in 64x64 tiles, allocated the first time a rover claims
+ * or bids for a cell in them, behind a row of tiles that is also allocated on
+ * first use. Memory follows where rovers have been rather than the size of
+ * the planet, so occupancy works on the huge tiled and sparse planets too.
+ * Tiles stay allocated until the layer goes away.
+ *
+ * Standalone rovers claim cells first come, first served, so when two of
+ * them race for a cell from separate threads the winner is whichever call
+ * lands first. Moves that have to be settled deterministically go through a
+ * Fleet, whose steps and tapes use the reservation words and give every
+ * contested cell to the lowest rover id.
+ **/
+class OccupancyLayer {
+public:
   /**
-   * GETTERS
+   * Id that never belongs to a rover; a free cell holds it
    **/
-  int getNumRows() { return this->obstacleMap.size(); }
-  int getNumCols() { return this->obstacleMap[0].size(); }
+  static const uint32_t NO_ROVER = 0;
 
   /**
-   * Places an obstacle at the given row and column
+   * Constructs an empty layer for a grid of the given size
+   * Only the directory of tile rows is allocated up front
    **/
-  void putObstacle(int row, int col) {
-    if (isInGrid(row, col) ) {
-      this->obstacleMap[row][col] = false;
+  OccupancyLayer(int numRows, int numCols) : nextRoverId(1), numAllocatedTiles(0) {
+    this->numTileRows = (numRows + TILE_SIZE - 1) / TILE_SIZE;
+    this->numTileCols = (numCols + TILE_SIZE - 1) / TILE_SIZE;
+    this->tileRows.reset(new std::atomic<std::atomic<Tile*>*>[this->numTileRows]);
+    for (int tileRow = 0; tileRow < this->numTileRows; tileRow++) {
+      this->tileRows[tileRow].store(nullptr, std::memory_order_relaxed);
     }
   }
 
   /**
-   * Checks whether the given row and column location is within the grid
-   * and has no obstacles
+   * Frees every tile the layer allocated
    **/
-  bool isValidLocation(int row, int col) {
-    if (isInGrid(row, col)) {
-      return this->obstacleMap[row][col];
-    } else {
-      return false;
+  ~OccupancyLayer() {
+    for (int tileRow = 0; tileRow < this->numTileRows; tileRow++) {
+      std::atomic<Tile*>* tiles = this->tileRows[tileRow].load(std::memory_order_relaxed);
+      if (!tiles) {
+        continue;
+      }
+      for (int tileCol = 0; tileCol < this->numTileCols; tileCol++) {
+        delete tiles[tileCol].load(std::memory_order_relaxed);
+      }
+      delete[] tiles;
     }
   }
 
+  OccupancyLayer(const OccupancyLayer&) = delete;
+  OccupancyLayer& operator=(const OccupancyLayer&) = delete;
+
   /**
-   * Checks if the given row and col is within the dimensions of the grid
+   * Hands out a new rover id; later ids are always higher
    **/
-  bool isInGrid(int row, int col) {
-    if (row < 0 || col < 0) {
-      return false;
-    } else if (row >= getNumRows()) {
-      return false;
-    } else if (col >= getNumCols()) {
-      return false;
-    } else {
-      return true;
-    }
+  uint32_t newRoverId() {
+    return this->nextRoverId.fetch_add(1);
   }
 
   /**
-   * Converts a row to a corresponding row on the grid (i.e. wrapping)
-   * Example: row 4 on a 3 row grid would return row 0
+   * Claims the given cell for a rover
+   * Returns false, changing nothing, if another rover already holds it
    **/
-  int convertToGridRow(int row) {
-    return (row % this->getNumRows() + this->getNumRows()) % this->getNumRows();
+  bool tryOccupy(int row, int col, uint32_t rover) {
+    uint32_t expected = NO_ROVER;
+    return tileAt(row, col).owners[cellInTile(row, col)].compare_exchange_strong(expected, rover, std::memory_order_acq_rel);
   }
 
   /**
-   * Converts a col to a corresponding col on the grid (i.e. wrapping)
+   * Gives up a cell the rover claimed with tryOccupy
    **/
-  int convertToGridCol(int col) {
-    return (col % this->getNumCols() + this->getNumCols()) % this->getNumCols();
+  void release(int row, int col, uint32_t rover) {
+    Tile* tile = findTile(row, col);
+    if (tile) {
+      uint32_t expected = rover;
+      tile->owners[cellInTile(row, col)].compare_exchange_strong(expected, NO_ROVER, std::memory_order_acq_rel);
+    }
   }
 
-private:
   /**
-   * 2D array, false value indicates spot is taken
+   * Id of the rover holding the given cell, or NO_ROVER
    **/
-  std::vector< std::vector<bool> > obstacleMap;
-};
-
-/**
- * Represents the four cardinal directions
- **/
-enum Direction {
-  NORTH = 0,
-  EAST = 1,
-  SOUTH = 2,
-  WEST = 3
-};
+  uint32_t getOwner(int row, int col) const {
+    Tile* tile = findTile(row, col);
+    return tile ? tile->owners[cellInTile(row, col)].load(std::memory_order_acquire) : NO_ROVER;
+  }
 
-/**
- * Represents a Rover object
- * A Rover has a (row, col) position, a direction, and a grid upon which it sits
- **/
-class Rover {
-public:
   /**
-   * Constructs a rover for a given (row, col) position, a direction, and a grid
+   * Checks whether a rover currently holds the given cell
    **/
-  Rover(int row, int col, Direction dir, Grid grid) {
-    // Validate that the given row and col is valid for the grid
-    // This checks both that the row/col is in the grid,
-    // and that there are no obstacles at this location
-    if (!grid.isValidLocation(row, col)) {
-      throw std::runtime_error("Rover cannot be placed here");
-    }
-
-    // Set vars
-    this->grid = grid;
-    this->dir = dir;
-    this->setRow(row);
-    this->setCol(col);
-
-    // Initialize available movements
-    this->initMovementPatternMap();
+  bool isOccupied(int row, int col) const {
+    return getOwner(row, col) != NO_ROVER;
   }
 
   /**
-   * GETTERS
+   * Bids for the given cell in a simultaneous move
+   * The reservation word ends up holding the lowest id of every bidder,
+   * whatever order the bids land in
    **/
-  int getRow() { return this->row; }
-  int getCol() { return this->col; }
-  int getDir() { return this->dir; }
-
+  void reserve(int row, int col, uint32_t rover) {
+    std::atomic<uint32_t>& reservation = tileAt(row, col).reservations[cellInTile(row, col)];
+    uint32_t current = reservation.load(std::memory_order_relaxed);
+    while ((current == NO_ROVER || rover < current) &&
+           !reservation.compare_exchange_weak(current, rover, std::memory_order_acq_rel)) {
+    }
+  }
 
   /**
-   * MOVEMENT
+   * Lowest id that has bid for the cell since it was last cleared, or NO_ROVER
    **/
+  uint32_t getReservation(int row, int col) const {
+    Tile* tile = findTile(row, col);
+    return tile ? tile->reservations[cellInTile(row, col)].load(std::memory_order_acquire) : NO_ROVER;
+  }
 
   /**
-   * Handles movement when input as a string
-   * Characters allowed are 'F', 'B', 'L', 'R'
+   * Resets the cell's reservation once a simultaneous move is settled
    **/
-  void move(std::string movements) {
-    for (char movement : movements) {
-      moveHelper(movement);
+  void clearReservation(int row, int col) {
+    Tile* tile = findTile(row, col);
+    if (tile) {
+      tile->reservations[cellInTile(row, col)].store(NO_ROVER, std::memory_order_release);
     }
   }
 
   /**
-   * Handles movement when input as a single character
-   * Characters allowed are 'F', 'B', 'L', 'R'
+   * Number of tiles allocated so far
    **/
-  void move(char movement) {
-    moveHelper(movement);
+  size_t getNumAllocatedTiles() const {
+    return this->numAllocatedTiles.load(std::memory_order_relaxed);
   }
 
-
 private:
+  static const int TILE_SHIFT = 6;
+  static const int TILE_SIZE = 1 << TILE_SHIFT;
+
   /**
-   * Current row and col of rover
+   * Owner and reservation words of one TILE_SIZE x TILE_SIZE block, row-major
    **/
-  int row, col;
+  struct Tile {
+    std::atomic<uint32_t> owners[TILE_SIZE * TILE_SIZE];
+    std::atomic<uint32_t> reservations[TILE_SIZE * TILE_SIZE];
+
+    Tile() {
+      for (int i = 0; i < TILE_SIZE * TILE_SIZE; i++) {
+        this->owners[i].store(NO_ROVER, std::memory_order_relaxed);
+        this->reservations[i].store(NO_ROVER, std::memory_order_relaxed);
+      }
+    }
+  };
 
   /**
-   * Direction rover is currently facing
+   * Size of the planet in tiles
    **/
-  Direction dir;
+  int numTileRows;
+  int numTileCols;
 
   /**
-   * Grid that rover is currently on
+   * Source of rover ids
    **/
-  Grid grid = Grid(0,0);
+  std::atomic<uint32_t> nextRoverId;
 
   /**
-   * Maps from a cardinal direction to what the corresponding
-   * forward movement (as a [row,col] pair) would look like
+   * Tiles allocated so far
    **/
-  std::vector< std::pair<int,int> > movementPatternMap;
+  std::atomic<size_t> numAllocatedTiles;
 
   /**
-   * Generates a mapping from cardinal direction to corresponding forward movement
+   * One entry per row of tiles, each nullptr or an array of numTileCols
+   * tile pointers, themselves nullptr until the tile is first written
    **/
-  void initMovementPatternMap() {
-    // Vector should hold the 4 cardinal directions
-    movementPatternMap.resize(4);
-    movementPatternMap[NORTH] = {1,0};
-    movementPatternMap[EAST] = {0,1};
-    movementPatternMap[SOUTH] = {-1,0};
-    movementPatternMap[WEST] = {0,-1};
+  std::unique_ptr<std::atomic<std::atomic<Tile*>*>[]> tileRows;
+
+  static int cellInTile(int row, int col) {
+    return ((row & (TILE_SIZE - 1)) << TILE_SHIFT) | (col & (TILE_SIZE - 1));
   }
 
   /**
-   * Determines the type of move (movement/rotation)
+   * Tile holding the given cell, or nullptr if no rover has been there
    **/
-  void moveHelper(char movement) {
-    switch (movement) {
-      // Forward
-      case 'F': {
-        bool isMoveForward = true;
-        moveRover(isMoveForward);
-        break;
-      }
-      // Backward
-      case 'B': {
-        bool isMoveForward = false;
-        moveRover(isMoveForward);
-        break;
-      }
-      // Left
-      case 'L': {
-        bool isRotateLeft = true;
-        rotateRover(isRotateLeft);
-        break;
+  Tile* findTile(int row, int col) const {
+    std::atomic<Tile*>* tiles = this->tileRows[row >> TILE_SHIFT].load(std::memory_order_acquire);
+    return tiles ? tiles[col >> TILE_SHIFT].load(std::memory_order_acquire) : nullptr;
+  }
+
+  /**
+   * Tile holding the given cell, allocating it and its row on first use
+   * Threads racing to allocate the same tile agree on one of their tiles
+   **/
+  Tile& tileAt(int row, int col) {
+    std::atomic<std::atomic<Tile*>*>& rowSlot = this->tileRows[row >> TILE_SHIFT];
+    std::atomic<Tile*>* tiles = rowSlot.load(std::memory_order_acquire);
+    if (!tiles) {
+      std::atomic<Tile*>* created = new std::atomic<Tile*>[this->numTileCols];
+      for (int tileCol = 0; tileCol < this->numTileCols; tileCol++) {
+        created[tileCol].store(nullptr, std::memory_order_relaxed);
       }
-      // Right
-      case 'R': {
-        bool isRotateLeft = false;
-        rotateRover(isRotateLeft);
-        break;
+      if (rowSlot.compare_exchange_strong(tiles, created, std::memory_order_acq_rel)) {
+        tiles = created;
+      } else {
+        delete[] created;
       }
-      default: {
-        throw std::runtime_error("Invalid movement");
-        break;
+    }
+
+    std::atomic<Tile*>& slot = tiles[col >> TILE_SHIFT];
+    Tile* tile = slot.load(std::memory_order_acquire);
+    if (!tile) {
+      Tile* created = new Tile();
+      if (slot.compare_exchange_strong(tile, created, std::memory_order_acq_rel)) {
+        tile = created;
+        this->numAllocatedTiles.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        delete created;
       }
     }
+    return *tile;
+  }
+};
+
+const uint32_t OccupancyLayer::NO_ROVER;
+
+/**
+ * GRID STORAGE POLICIES
+ *
+ * A storage policy owns the obstacle map of a grid. Every policy provides
+ *   Policy(int numRows, int numCols)
+ *   bool hasObstacle(int row, int col) const
+ *   void setObstacle(int row, int col)
+ *   void clearObstacle(int row, int col)
+ *   size_t freeRunInRow(int row, int col, bool increasing, size_t maxSteps) const
+ *   size_t freeRunInCol(int row, int col, bool increasing, size_t maxSteps) const
+ *   size_t setObstacles(const std::pair<int, int>* cells, size_t numCells, unsigned numThreads)
+ *   size_t setObstacleRect(int firstRow, int firstCol, int lastRow, int lastCol)
+ * for cells the grid has already bounds-checked, so BasicGrid can be
+ * instantiated over any of them with no virtual calls on the hot path.
+ * setObstacles skips cells outside the grid by itself, and both bulk calls
+ * return how many cells were not obstacles before. Read-only policies leave
+ * out the setters and are filled on construction instead.
+ **/
+
+/**
+ * Allocator that leaves trivially constructible elements uninitialised when
+ * a vector grows, so storage about to be overwritten is not zero-filled first
+ **/
+template <typename T>
+struct DefaultInitAllocator : std::allocator<T> {
+  template <typename U>
+  struct rebind {
+    typedef DefaultInitAllocator<U> other;
+  };
+
+  DefaultInitAllocator() {}
+
+  template <typename U>
+  DefaultInitAllocator(const DefaultInitAllocator<U>&) {}
+
+  template <typename U>
+  void construct(U* pointer) {
+    ::new ((void*) pointer) U;
+  }
+
+  template <typename U, typename... Args>
+  void construct(U* pointer, Args&&... args) {
+    ::new ((void*) pointer) U(std::forward<Args>(args)...);
+  }
+};
+
+/**
+ * Flat, row-padded bitset covering the whole grid
+ * The fastest policy for maps that fit in memory, and the one whose word
+ * layout the SIMD kernels read directly
+ *
+ * Runs along a column are scanned in a transposed, column-major copy of the
+ * bitset. The copy is built the first time a column is scanned, and kept up
+ * to date by every write from then on; it doubles the storage's memory, so
+ * grids that are never scanned along a column do not pay for it.
+ **/
+class DenseBitsetStorage {
+public:
+  /**
+   * Number of grid cells packed into a single word of the obstacle bitset
+   **/
+  static const int BITS_PER_WORD = 64;
+
+  /**
+   * Marks a storage whose words are left unset, for callers that overwrite all of them
+   **/
+  struct Uninitialized {};
+
+  DenseBitsetStorage(int numRows, int numCols) : hasColumns(false) {
+    setDimensions(numRows, numCols);
+    this->obstacleWords.assign(this->obstacleWords.size(), 0);
   }
 
   /**
-   * Moves the rover forwards/backwards
+   * Sizes the bitset without clearing it; loadBitmap must run before any other call
    **/
-  void moveRover(bool isMoveForward) {
-    // Get the available movement pattern for the rover's current direction
-    std::pair<int, int> movementPattern = movementPatternMap[this->getDir()];
+  DenseBitsetStorage(int numRows, int numCols, Uninitialized) : hasColumns(false) {
+    setDimensions(numRows, numCols);
+  }
 
-    int newRow, newCol;
-    if (isMoveForward) {
-      newRow = this->grid.convertToGridRow(this->getRow() + movementPattern.first);
-      newCol = this->grid.convertToGridCol(this->getCol() + movementPattern.second);
-    } else {
-      newRow = this->grid.convertToGridRow(this->getRow() - movementPattern.first);
-      newCol = this->grid.convertToGridCol(this->getCol() - movementPattern.second);
-    }
+  /**
+   * Copies keep the column view if the original has built it
+   **/
+  DenseBitsetStorage(const DenseBitsetStorage& other)
+      : numRows(other.numRows), numCols(other.numCols), wordsPerRow(other.wordsPerRow),
+        obstacleWords(other.obstacleWords), wordsPerCol(other.wordsPerCol), hasColumns(false) {
+    std::lock_guard<std::mutex> lock(other.columnMutex);
+    this->columnWords = other.columnWords;
+    this->hasColumns.store(other.hasColumns.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
 
-    // Verifies that the new row and column have no obstacles placed
-    if (this->grid.isValidLocation(newRow, newCol)) {
-      this->setRow(newRow);
-      this->setCol(newCol);
-    } else {
-      std::string errorMessage = "Obstacle encountered at: " + std::to_string(newRow) + ", " + std::to_string(newCol);
-      throw std::runtime_error(errorMessage);
+  DenseBitsetStorage(DenseBitsetStorage&& other) noexcept
+      : numRows(other.numRows), numCols(other.numCols), wordsPerRow(other.wordsPerRow),
+        obstacleWords(std::move(other.obstacleWords)), wordsPerCol(other.wordsPerCol),
+        columnWords(std::move(other.columnWords)), hasColumns(other.hasColumns.load(std::memory_order_relaxed)) {
+    other.hasColumns.store(false, std::memory_order_relaxed);
+  }
+
+  DenseBitsetStorage& operator=(DenseBitsetStorage other) {
+    this->numRows = other.numRows;
+    this->numCols = other.numCols;
+    this->wordsPerRow = other.wordsPerRow;
+    this->obstacleWords.swap(other.obstacleWords);
+    this->wordsPerCol = other.wordsPerCol;
+    this->columnWords.swap(other.columnWords);
+    this->hasColumns.store(other.hasColumns.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    return *this;
+  }
+
+  bool hasObstacle(int row, int col) const {
+    return (this->obstacleWords[(size_t) row * this->wordsPerRow + col / BITS_PER_WORD] & bitMask(col)) != 0;
+  }
+
+  void setObstacle(int row, int col) {
+    setIfClear(row, col);
+  }
+
+  void clearObstacle(int row, int col) {
+    this->obstacleWords[(size_t) row * this->wordsPerRow + col / BITS_PER_WORD] &= ~bitMask(col);
+    if (this->hasColumns.load(std::memory_order_relaxed)) {
+      this->columnWords[(size_t) col * this->wordsPerCol + row / BITS_PER_WORD] &= ~bitMask(row);
     }
   }
 
   /**
-   * Rotates the rover left/right
+   * Sets many cells at once on up to numThreads threads
+   *
+   * Cells are bucketed by band of 64 rows, and each thread then sets the
+   * cells of its own bands. A band covers whole words of both the row bitset
+   * and the column view, so no two threads ever write the same word.
    **/
-  void rotateRover(bool isRotateLeft) {
-    switch (this->getDir()) {
-      case NORTH: {
-        this->setDir(isRotateLeft ? WEST : EAST);
-        break;
+  size_t setObstacles(const std::pair<int, int>* cells, size_t numCells, unsigned numThreads) {
+    size_t numBands = this->wordsPerCol;
+    size_t numTasks = std::min<size_t>(std::min<size_t>(numThreads, numBands), numCells / PARALLEL_MIN_CELLS);
+    if (numTasks <= 1) {
+      size_t numSet = 0;
+      for (size_t i = 0; i < numCells; i++) {
+        if (isInGrid(cells[i].first, cells[i].second) && setIfClear(cells[i].first, cells[i].second)) {
+          numSet++;
+        }
       }
-      case EAST: {
-        this->setDir(isRotateLeft ? NORTH : SOUTH);
-        break;
+      return numSet;
+    }
+
+    // Task t reads input chunk t and owns bands [t, t + 1) * numBands / numTasks
+    size_t chunkSize = (numCells + numTasks - 1) / numTasks;
+    std::vector<size_t> bucketSizes(numTasks * numTasks, 0);
+    runInParallel(numTasks, [&](size_t chunk) {
+      size_t end = std::min(numCells, (chunk + 1) * chunkSize);
+      for (size_t i = chunk * chunkSize; i < end; i++) {
+        if (isInGrid(cells[i].first, cells[i].second)) {
+          bucketSizes[chunk * numTasks + ownerOf(cells[i].first, numBands, numTasks)]++;
+        }
       }
-      case SOUTH: {
-        this->setDir(isRotateLeft ? EAST : WEST);
-        break;
+    });
+
+    // Owner-major offsets, so each owner's cells end up contiguous
+    std::vector<size_t> bucketOffsets(numTasks * numTasks);
+    std::vector<size_t> ownerBegin(numTasks + 1, 0);
+    size_t offset = 0;
+    for (size_t owner = 0; owner < numTasks; owner++) {
+      ownerBegin[owner] = offset;
+      for (size_t chunk = 0; chunk < numTasks; chunk++) {
+        bucketOffsets[chunk * numTasks + owner] = offset;
+        offset += bucketSizes[chunk * numTasks + owner];
       }
-      case WEST: {
-        this->setDir(isRotateLeft ? SOUTH : WEST);
-        break;
+    }
+    ownerBegin[numTasks] = offset;
+
+    std::vector<std::pair<int, int>> bucketed(offset);
+    runInParallel(numTasks, [&](size_t chunk) {
+      size_t* cursors = &bucketOffsets[chunk * numTasks];
+      size_t end = std::min(numCells, (chunk + 1) * chunkSize);
+      for (size_t i = chunk * chunkSize; i < end; i++) {
+        if (isInGrid(cells[i].first, cells[i].second)) {
+          bucketed[cursors[ownerOf(cells[i].first, numBands, numTasks)]++] = cells[i];
+        }
       }
-      default: {
-        throw std::runtime_error("Cannot rotate");
-        break;
+    });
+
+    std::vector<size_t> numSet(numTasks, 0);
+    runInParallel(numTasks, [&](size_t owner) {
+      for (size_t i = ownerBegin[owner]; i < ownerBegin[owner + 1]; i++) {
+        if (setIfClear(bucketed[i].first, bucketed[i].second)) {
+          numSet[owner]++;
+        }
       }
+    });
+    size_t total = 0;
+    for (size_t count : numSet) {
+      total += count;
     }
-
+    return total;
   }
 
   /**
-   * SETTERS
+   * Sets a rectangle of cells a word at a time, in the bitset and any column view
    **/
-  void setRow(int row) { this->row = row; }
-  void setCol(int col) { this->col = col; }
-  void setDir(Direction dir) { this->dir = dir; }
+  size_t setObstacleRect(int firstRow, int firstCol, int lastRow, int lastCol) {
+    size_t numSet = 0;
+    for (int row = firstRow; row <= lastRow; row++) {
+      numSet += setBitRange(this->obstacleWords.data() + (size_t) row * this->wordsPerRow, firstCol, lastCol);
+    }
+    if (this->hasColumns.load(std::memory_order_relaxed)) {
+      for (int col = firstCol; col <= lastCol; col++) {
+        setBitRange(this->columnWords.data() + (size_t) col * this->wordsPerCol, firstRow, lastRow);
+      }
+    }
+    return numSet;
+  }
 
-};
+  size_t freeRunInRow(int row, int col, bool increasing, size_t maxSteps) const {
+    return freeRunAlongLine(getRowWords(row), this->numCols, col, increasing, maxSteps);
+  }
 
+  size_t freeRunInCol(int row, int col, bool increasing, size_t maxSteps) const {
+    return freeRunAlongLine(getColWords(col), this->numRows, row, increasing, maxSteps);
+  }
 
-/**
- * TESTS GO HERE
- **/
+  /**
+   * Replaces every obstacle with the set bits of a packed bitmap holding one
+   * row of bytesPerRow bytes after another, leftmost cell in the most
+   * significant bit of each byte (the PBM layout). Returns the number of obstacles
+   **/
+  size_t loadBitmap(const uint8_t* bitmap, size_t bytesPerRow) {
+    // Every word of the bitset is written, so it needs no clearing first.
+    // Any column view is dropped and rebuilt on the next column scan
+    size_t numObstacles = 0;
+    for (int row = 0; row < this->numRows; row++) {
+      numObstacles += loadBitmapRow(bitmap + (size_t) row * bytesPerRow, bytesPerRow, row);
+    }
+    this->hasColumns.store(false, std::memory_order_relaxed);
+    std::vector<uint64_t, DefaultInitAllocator<uint64_t> >().swap(this->columnWords);
+    return numObstacles;
+  }
 
-// Testing Grid class
-TEST_CASE( "Grid Construction Test", "[grid]" ) {
-    Grid grid = Grid(1, 4);
-    REQUIRE( grid.getNumRows() == 1 );
-    REQUIRE( grid.getNumCols() == 4 );
-}
 
-TEST_CASE( "Grid Obstacle Test", "[grid]" ) {
-    Grid grid = Grid(4, 4);
-    grid.putObstacle(1,1);
-    grid.putObstacle(2,2);
+  /**
+   * Number of 64-bit words used by each row of the obstacle bitset (the row stride)
+   **/
+  int getWordsPerRow() const { return this->wordsPerRow; }
+
+  /**
+   * Raw obstacle bitset, row-major with getWordsPerRow() words per row.
+   * Bit (col % 64) of word (row * getWordsPerRow() + col / 64) is set when
+   * the cell holds an obstacle. Padding bits at the end of each row are always clear.
+   **/
+  const uint64_t* getObstacleWords() const { return this->obstacleWords.data(); }
+
+  /**
+   * First word of the given row in the obstacle bitset
+   **/
+  const uint64_t* getRowWords(int row) const {
+    return this->obstacleWords.data() + (size_t) row * this->wordsPerRow;
+  }
+
+  /**
+   * Number of 64-bit words used by each column of the transposed bitset
+   **/
+  int getWordsPerCol() const { return this->wordsPerCol; }
+
+  /**
+   * First word of the given column in the column view, building the view if needed
+   * Bit (row % 64) of word (row / 64) is set when the cell holds an obstacle
+   **/
+  const uint64_t* getColWords(int col) const {
+    buildColumns();
+    return this->columnWords.data() + (size_t) col * this->wordsPerCol;
+  }
+
+  /**
+   * Whether the column view has been built
+   **/
+  bool hasColumnView() const { return this->hasColumns.load(std::memory_order_acquire); }
+
+private:
+  /**
+   * Dimensions of the grid
+   **/
+  int numRows, numCols;
+
+  /**
+   * Row stride of the bitset, in words
+   **/
+  int wordsPerRow;
+
+  /**
+   * Flat obstacle bitset, a set bit indicates spot is taken
+   **/
+  std::vector<uint64_t, DefaultInitAllocator<uint64_t> > obstacleWords;
+
+  /**
+   * Column stride of the transposed bitset, in words
+   **/
+  int wordsPerCol;
+
+  /**
+   * Same obstacles as obstacleWords, stored column-major
+   * Empty until the first column scan builds it
+   **/
+  mutable std::vector<uint64_t, DefaultInitAllocator<uint64_t> > columnWords;
+
+  /**
+   * Whether columnWords has been built, set once it is complete
+   **/
+  mutable std::atomic<bool> hasColumns;
+
+  /**
+   * Held while the column view is built, so concurrent readers build it once
+   **/
+  mutable std::mutex columnMutex;
+
+  /**
+   * Mask selecting the given column's bit within its word
+   **/
+  static uint64_t bitMask(int col) {
+    return (uint64_t) 1 << (col % BITS_PER_WORD);
+  }
+
+  /**
+   * Fewest cells worth handing to each thread of a bulk insertion
+   **/
+  static const size_t PARALLEL_MIN_CELLS = 1 << 16;
+
+  bool isInGrid(int row, int col) const {
+    return (unsigned) row < (unsigned) this->numRows && (unsigned) col < (unsigned) this->numCols;
+  }
+
+  /**
+   * Sets a cell in the bitset and any column view, returning false if it was already set
+   **/
+  bool setIfClear(int row, int col) {
+    uint64_t& word = this->obstacleWords[(size_t) row * this->wordsPerRow + col / BITS_PER_WORD];
+    if ((word & bitMask(col)) != 0) {
+      return false;
+    }
+    word |= bitMask(col);
+    if (this->hasColumns.load(std::memory_order_relaxed)) {
+      this->columnWords[(size_t) col * this->wordsPerCol + row / BITS_PER_WORD] |= bitMask(row);
+    }
+    return true;
+  }
+
+  /**
+   * Which of numTasks threads owns the band of 64 rows holding the given row
+   **/
+  static size_t ownerOf(int row, size_t numBands, size_t numTasks) {
+    return (size_t) (row / BITS_PER_WORD) * numTasks / numBands;
+  }
+
+  void setDimensions(int numRows, int numCols) {
+    this->numRows = numRows;
+    this->numCols = numCols;
+    // Every row starts on a fresh word, padding bits past numCols stay clear
+    this->wordsPerRow = (numCols + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    this->obstacleWords.resize((size_t) numRows * this->wordsPerRow);
+    this->wordsPerCol = (numRows + BITS_PER_WORD - 1) / BITS_PER_WORD;
+  }
+
+  /**
+   * Builds the column view if no column has been scanned yet
+   * A few bands of 64 rows at a time, so each column gets a whole cache line of words
+   **/
+  void buildColumns() const {
+    if (this->hasColumns.load(std::memory_order_acquire)) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(this->columnMutex);
+    if (this->hasColumns.load(std::memory_order_relaxed)) {
+      return;
+    }
+    this->columnWords.resize((size_t) this->numCols * this->wordsPerCol);
+    for (int firstRowWord = 0; firstRowWord < this->wordsPerCol; firstRowWord += BANDS_PER_PASS) {
+      transposeBands(firstRowWord, std::min(this->wordsPerCol, firstRowWord + BANDS_PER_PASS));
+    }
+    this->hasColumns.store(true, std::memory_order_release);
+  }
+
+  /**
+   * Converts one bitmap row into the row bitset, returning its number of obstacles
+   **/
+  size_t loadBitmapRow(const uint8_t* rowBytes, size_t bytesPerRow, int row) {
+    uint64_t* words = this->obstacleWords.data() + (size_t) row * this->wordsPerRow;
+    // Whole words use a fixed-size copy, which compiles to a single load
+    int numWholeWords = (int) (bytesPerRow / 8);
+    for (int i = 0; i < this->wordsPerRow; i++) {
+      uint64_t word = 0;
+      if (i < numWholeWords) {
+        std::memcpy(&word, rowBytes + (size_t) i * 8, 8);
+      } else {
+        std::memcpy(&word, rowBytes + (size_t) i * 8, bytesPerRow - (size_t) i * 8);
+      }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      word = __builtin_bswap64(word);
+#endif
+      words[i] = reverseBitsInEachByte(word);
+    }
+    // Bitmap rows are padded to whole bytes; the grid's padding bits must stay clear
+    if (this->numCols % BITS_PER_WORD != 0) {
+      words[this->wordsPerRow - 1] &= ((uint64_t) 1 << (this->numCols % BITS_PER_WORD)) - 1;
+    }
+    size_t numObstacles = 0;
+    for (int i = 0; i < this->wordsPerRow; i++) {
+      numObstacles += countSetBits(words[i]);
+    }
+    return numObstacles;
+  }
+
+  /**
+   * Bands of 64 rows transposed together by buildColumns
+   **/
+  static const int BANDS_PER_PASS = 8;
+
+  /**
+   * Writes the transposed bitset's words for bands [firstRowWord, lastRowWord), 64x64 cells at a time
+   **/
+  void transposeBands(int firstRowWord, int lastRowWord) const {
+    uint64_t block[64];
+    for (int colWord = 0; colWord < this->wordsPerRow; colWord++) {
+      for (int rowWord = firstRowWord; rowWord < lastRowWord; rowWord++) {
+        for (int i = 0; i < 64; i++) {
+          int row = rowWord * 64 + i;
+          block[i] = row < this->numRows ? this->obstacleWords[(size_t) row * this->wordsPerRow + colWord] : 0;
+        }
+        transposeBitBlock(block);
+        for (int i = 0; i < 64 && colWord * 64 + i < this->numCols; i++) {
+          this->columnWords[(size_t) (colWord * 64 + i) * this->wordsPerCol + rowWord] = block[i];
+        }
+      }
+    }
+  }
+};
+
+/**
+ * Bitset split into 64x64 tiles that are only allocated once they hold an obstacle
+ *
+ * Tiles sit at the bottom of a radix trie with 64 children per node, indexed
+ * by tile position in row-major order; untouched subtrees are simply absent,
+ * so an empty planet of any size costs nothing and memory grows with the
+ * number of tiles that hold obstacles.
+ *
+ * Nodes and tiles are reference counted and shared between copies, so a
+ * copy is a new persistent version of the map made in O(1). Writing to a
+ * version first copies the tile it touches and the trie nodes above it if any
+ * other version still shares them. Each branch therefore costs only the tiles
+ * it changes, and older versions stay readable, from any thread, while
+ * new ones are built.
+ **/
+class TiledBitsetStorage {
+public:
+  /**
+   * Cells along each side of a tile
+   **/
+  static const int TILE_SIZE = 64;
+
+  /**
+   * A tile's cells, stored both row-major and column-major so that runs in
+   * either direction can be scanned a word at a time
+   **/
+  struct Tile {
+    uint64_t rowWords[TILE_SIZE];
+    uint64_t colWords[TILE_SIZE];
+  };
+
+  TiledBitsetStorage(int numRows, int numCols) {
+    this->numRows = numRows;
+    this->numCols = numCols;
+    this->numTileCols = (numCols + TILE_SIZE - 1) / TILE_SIZE;
+    size_t numTiles = (size_t) ((numRows + TILE_SIZE - 1) / TILE_SIZE) * this->numTileCols;
+    this->depth = 1;
+    while (((size_t) 1 << (NODE_BITS * this->depth)) < numTiles) {
+      this->depth++;
+    }
+  }
+
+  bool hasObstacle(int row, int col) const {
+    const Tile* tile = findTile(tileIndex(row / TILE_SIZE, col / TILE_SIZE));
+    return ((tile->rowWords[row % TILE_SIZE] >> (col % TILE_SIZE)) & 1) != 0;
+  }
+
+  void setObstacle(int row, int col) {
+    Tile* tile = writableTile(row / TILE_SIZE, col / TILE_SIZE);
+    tile->rowWords[row % TILE_SIZE] |= (uint64_t) 1 << (col % TILE_SIZE);
+    tile->colWords[col % TILE_SIZE] |= (uint64_t) 1 << (row % TILE_SIZE);
+  }
+
+  /**
+   * Clears a cell; its tile stays allocated even once it is empty again
+   **/
+  void clearObstacle(int row, int col) {
+    if (getTile(row / TILE_SIZE, col / TILE_SIZE) != nullptr) {
+      Tile* tile = writableTile(row / TILE_SIZE, col / TILE_SIZE);
+      tile->rowWords[row % TILE_SIZE] &= ~((uint64_t) 1 << (col % TILE_SIZE));
+      tile->colWords[col % TILE_SIZE] &= ~((uint64_t) 1 << (row % TILE_SIZE));
+    }
+  }
+
+  /**
+   * Sets many cells at once
+   * Runs on one thread whatever numThreads is, as tiles are allocated on first write
+   **/
+  size_t setObstacles(const std::pair<int, int>* cells, size_t numCells, unsigned) {
+    size_t numSet = 0;
+    for (size_t i = 0; i < numCells; i++) {
+      int row = cells[i].first;
+      int col = cells[i].second;
+      if ((unsigned) row < (unsigned) this->numRows && (unsigned) col < (unsigned) this->numCols &&
+          !hasObstacle(row, col)) {
+        setObstacle(row, col);
+        numSet++;
+      }
+    }
+    return numSet;
+  }
+
+  /**
+   * Sets a rectangle of cells a tile word at a time
+   **/
+  size_t setObstacleRect(int firstRow, int firstCol, int lastRow, int lastCol) {
+    size_t numSet = 0;
+    for (int tileRow = firstRow / TILE_SIZE; tileRow <= lastRow / TILE_SIZE; tileRow++) {
+      int top = std::max(firstRow, tileRow * TILE_SIZE);
+      int bottom = std::min(lastRow, tileRow * TILE_SIZE + TILE_SIZE - 1);
+      for (int tileCol = firstCol / TILE_SIZE; tileCol <= lastCol / TILE_SIZE; tileCol++) {
+        int left = std::max(firstCol, tileCol * TILE_SIZE);
+        int right = std::min(lastCol, tileCol * TILE_SIZE + TILE_SIZE - 1);
+        Tile* tile = writableTile(tileRow, tileCol);
+        for (int row = top; row <= bottom; row++) {
+          numSet += setBitRange(&tile->rowWords[row % TILE_SIZE], left % TILE_SIZE, right % TILE_SIZE);
+        }
+        for (int col = left; col <= right; col++) {
+          setBitRange(&tile->colWords[col % TILE_SIZE], top % TILE_SIZE, bottom % TILE_SIZE);
+        }
+      }
+    }
+    return numSet;
+  }
+
+  size_t freeRunInRow(int row, int col, bool increasing, size_t maxSteps) const {
+    return freeRunAlongLine(RowLine(this, row), this->numCols, col, increasing, maxSteps);
+  }
+
+  size_t freeRunInCol(int row, int col, bool increasing, size_t maxSteps) const {
+    return freeRunAlongLine(ColLine(this, col), this->numRows, row, increasing, maxSteps);
+  }
+
+  /**
+   * The tile at the given tile coordinates, or nullptr if it has never held an obstacle
+   * Versions that still share a tile return the same pointer for it
+   **/
+  const Tile* getTile(int tileRow, int tileCol) const {
+    const Tile* tile = findTile(tileIndex(tileRow, tileCol));
+    return tile != &EMPTY_TILE ? tile : nullptr;
+  }
+
+  /**
+   * Number of tiles this version has allocated, whether or not it shares them
+   **/
+  size_t getNumAllocatedTiles() const { return countTiles(this->root.get(), this->depth - 1); }
+
+private:
+  /**
+   * Each trie node has 2^NODE_BITS children
+   **/
+  static const int NODE_BITS = 6;
+  static const int NODE_SIZE = 1 << NODE_BITS;
+
+  /**
+   * Interior trie node; children on the lowest level are Tiles, higher up they are Nodes
+   **/
+  struct Node {
+    std::shared_ptr<void> children[NODE_SIZE];
+  };
+
+  /**
+   * Read in place of every tile that is not allocated; never written
+   **/
+  static const Tile EMPTY_TILE;
+
+  /**
+   * Dimensions of the grid, and its width in tiles
+   **/
+  int numRows, numCols;
+  int numTileCols;
+
+  /**
+   * Levels of Nodes between the root and the tiles, and the root itself
+   * (null while the map is empty)
+   **/
+  int depth;
+  std::shared_ptr<void> root;
+
+  size_t tileIndex(int tileRow, int tileCol) const {
+    return (size_t) tileRow * this->numTileCols + tileCol;
+  }
+
+  /**
+   * The tile with the given index, or EMPTY_TILE
+   **/
+  const Tile* findTile(size_t index) const {
+    const void* node = this->root.get();
+    for (int level = this->depth - 1; level >= 0 && node != nullptr; level--) {
+      node = ((const Node*) node)->children[(index >> (NODE_BITS * level)) & (NODE_SIZE - 1)].get();
+    }
+    return node != nullptr ? (const Tile*) node : &EMPTY_TILE;
+  }
+
+  /**
+   * The i-th word along a row of the grid, read across tiles
+   **/
+  struct RowLine {
+    RowLine(const TiledBitsetStorage* storage, int row)
+        : storage(storage), firstTile(storage->tileIndex(row / TILE_SIZE, 0)), rowInTile(row % TILE_SIZE) {}
+    uint64_t operator[](int i) const { return this->storage->findTile(this->firstTile + i)->rowWords[this->rowInTile]; }
+    const TiledBitsetStorage* storage;
+    size_t firstTile;
+    int rowInTile;
+  };
+
+  /**
+   * The i-th word along a column of the grid, read across tiles
+   **/
+  struct ColLine {
+    ColLine(const TiledBitsetStorage* storage, int col)
+        : storage(storage), tileCol(col / TILE_SIZE), colInTile(col % TILE_SIZE) {}
+    uint64_t operator[](int i) const {
+      return this->storage->findTile(this->storage->tileIndex(i, this->tileCol))->colWords[this->colInTile];
+    }
+    const TiledBitsetStorage* storage;
+    int tileCol;
+    int colInTile;
+  };
+
+  /**
+   * Tile at the given tile coordinates, private to this version, allocating
+   * or copying it and the nodes above it as needed
+   **/
+  Tile* writableTile(int tileRow, int tileCol) {
+    size_t index = tileIndex(tileRow, tileCol);
+    std::shared_ptr<void>* slot = &this->root;
+    for (int level = this->depth - 1; level >= 0; level--) {
+      Node* node = ownSlot<Node>(*slot);
+      slot = &node->children[(index >> (NODE_BITS * level)) & (NODE_SIZE - 1)];
+    }
+    return ownSlot<Tile>(*slot);
+  }
+
+  /**
+   * Makes the object in a slot private to this version, creating it if the
+   * slot is empty and copying it if another version shares it
+   **/
+  template <typename T>
+  static T* ownSlot(std::shared_ptr<void>& slot) {
+    if (!slot) {
+      slot = std::make_shared<T>();
+    } else if (slot.use_count() > 1) {
+      slot = std::make_shared<T>(*(const T*) slot.get());
+    }
+    return (T*) slot.get();
+  }
+
+  static size_t countTiles(const void* node, int level) {
+    if (node == nullptr) {
+      return 0;
+    } else if (level < 0) {
+      return 1;
+    }
+    size_t count = 0;
+    for (const std::shared_ptr<void>& child : ((const Node*) node)->children) {
+      count += countTiles(child.get(), level - 1);
+    }
+    return count;
+  }
+};
+
+const size_t DenseBitsetStorage::PARALLEL_MIN_CELLS;
+
+const TiledBitsetStorage::Tile TiledBitsetStorage::EMPTY_TILE = TiledBitsetStorage::Tile();
+
+/**
+ * Obstacles kept as a set of cells, for huge planets that are almost empty
+ *
+ * Membership is an open-addressing hash set of packed (row, col) keys with
+ * linear probing, so a lookup usually touches a single cache line. Each row
+ * and column that holds obstacles also keeps them in a sorted list, so a run
+ * finds its next obstacle with a binary search. Memory grows with the number
+ * of obstacles, not with the size of the planet.
+ **/
+class SparseObstacleStorage {
+public:
+  SparseObstacleStorage(int numRows, int numCols)
+      : numRows(numRows), numCols(numCols), numKeys(0), keys(MIN_CAPACITY, EMPTY_KEY) {}
+
+  bool hasObstacle(int row, int col) const {
+    uint64_t key = packKey(row, col);
+    for (size_t slot = slotFor(key); ; slot = (slot + 1) & (this->keys.size() - 1)) {
+      if (this->keys[slot] == key) {
+        return true;
+      } else if (this->keys[slot] == EMPTY_KEY) {
+        return false;
+      }
+    }
+  }
+
+  void setObstacle(int row, int col) {
+    if (hasObstacle(row, col)) {
+      return;
+    }
+    // Keep the table at most half full so probe sequences stay short
+    if (2 * (this->numKeys + 1) > this->keys.size()) {
+      rehash(2 * this->keys.size());
+    }
+    insertKey(packKey(row, col));
+    insertSorted(this->rowObstacles[row], col);
+    insertSorted(this->colObstacles[col], row);
+  }
+
+  /**
+   * Removes a cell from the set and from its row and column lists
+   **/
+  void clearObstacle(int row, int col) {
+    uint64_t key = packKey(row, col);
+    size_t mask = this->keys.size() - 1;
+    size_t hole = slotFor(key);
+    while (this->keys[hole] != key) {
+      if (this->keys[hole] == EMPTY_KEY) {
+        return;
+      }
+      hole = (hole + 1) & mask;
+    }
+    // Pull later keys of the probe run back into the hole, so lookups never stop short at it.
+    // A key can move into the hole if the hole lies between its home slot and where it is now
+    for (size_t next = (hole + 1) & mask; this->keys[next] != EMPTY_KEY; next = (next + 1) & mask) {
+      if (((next - slotFor(this->keys[next])) & mask) >= ((next - hole) & mask)) {
+        this->keys[hole] = this->keys[next];
+        hole = next;
+      }
+    }
+    this->keys[hole] = EMPTY_KEY;
+    this->numKeys--;
+    eraseSorted(this->rowObstacles, row, col);
+    eraseSorted(this->colObstacles, col, row);
+  }
+
+  /**
+   * Sets many cells at once, on one thread
+   **/
+  size_t setObstacles(const std::pair<int, int>* cells, size_t numCells, unsigned) {
+    size_t numSet = 0;
+    for (size_t i = 0; i < numCells; i++) {
+      int row = cells[i].first;
+      int col = cells[i].second;
+      if ((unsigned) row < (unsigned) this->numRows && (unsigned) col < (unsigned) this->numCols &&
+          !hasObstacle(row, col)) {
+        setObstacle(row, col);
+        numSet++;
+      }
+    }
+    return numSet;
+  }
+
+  /**
+   * Sets a rectangle of cells one by one; a sparse map is the wrong choice for large filled areas
+   **/
+  size_t setObstacleRect(int firstRow, int firstCol, int lastRow, int lastCol) {
+    size_t numSet = 0;
+    for (int row = firstRow; row <= lastRow; row++) {
+      for (int col = firstCol; col <= lastCol; col++) {
+        if (!hasObstacle(row, col)) {
+          setObstacle(row, col);
+          numSet++;
+        }
+      }
+    }
+    return numSet;
+  }
+
+  size_t freeRunInRow(int row, int col, bool increasing, size_t maxSteps) const {
+    return freeRunAlongList(this->rowObstacles, row, this->numCols, col, increasing, maxSteps);
+  }
+
+  size_t freeRunInCol(int row, int col, bool increasing, size_t maxSteps) const {
+    return freeRunAlongList(this->colObstacles, col, this->numRows, row, increasing, maxSteps);
+  }
+
+  /**
+   * Number of slots in the hash set
+   **/
+  size_t getCapacity() const { return this->keys.size(); }
+
+private:
+  /**
+   * Marks an unused slot; no packed cell has every bit set since rows and columns are non-negative
+   **/
+  static const uint64_t EMPTY_KEY = ~(uint64_t) 0;
+
+  /**
+   * Initial number of slots, always a power of two
+   **/
+  static const size_t MIN_CAPACITY = 16;
+
+  /**
+   * Dimensions of the grid
+   **/
+  int numRows, numCols;
+
+  /**
+   * Open-addressing hash set of packed cells
+   **/
+  size_t numKeys;
+  std::vector<uint64_t> keys;
+
+  /**
+   * Sorted obstacle columns of every row holding one, and sorted obstacle rows of every such column
+   **/
+  std::unordered_map<int, std::vector<int>> rowObstacles;
+  std::unordered_map<int, std::vector<int>> colObstacles;
+
+  static uint64_t packKey(int row, int col) {
+    return ((uint64_t) (uint32_t) row << 32) | (uint32_t) col;
+  }
+
+  /**
+   * Home slot of a key, by Fibonacci hashing so neighbouring cells spread out
+   **/
+  size_t slotFor(uint64_t key) const {
+    return (size_t) ((key * 0x9E3779B97F4A7C15ull) >> 32) & (this->keys.size() - 1);
+  }
+
+  void insertKey(uint64_t key) {
+    size_t slot = slotFor(key);
+    while (this->keys[slot] != EMPTY_KEY) {
+      slot = (slot + 1) & (this->keys.size() - 1);
+    }
+    this->keys[slot] = key;
+    this->numKeys++;
+  }
+
+  void rehash(size_t capacity) {
+    std::vector<uint64_t> oldKeys(capacity, EMPTY_KEY);
+    oldKeys.swap(this->keys);
+    this->numKeys = 0;
+    for (uint64_t key : oldKeys) {
+      if (key != EMPTY_KEY) {
+        insertKey(key);
+      }
+    }
+  }
+
+  static void insertSorted(std::vector<int>& list, int value) {
+    list.insert(std::lower_bound(list.begin(), list.end(), value), value);
+  }
+
+  /**
+   * Removes a value from one line's sorted list, dropping the list once it is empty
+   **/
+  static void eraseSorted(std::unordered_map<int, std::vector<int>>& lists, int line, int value) {
+    std::vector<int>& list = lists[line];
+    list.erase(std::lower_bound(list.begin(), list.end(), value));
+    if (list.empty()) {
+      lists.erase(line);
+    }
+  }
+
+  /**
+   * Same as freeRunAlongLine, but finds the next obstacle on the line by
+   * binary search in its sorted obstacle list
+   **/
+  static size_t freeRunAlongList(const std::unordered_map<int, std::vector<int>>& lists, int line,
+                                 int length, int start, bool increasing, size_t maxSteps) {
+    std::unordered_map<int, std::vector<int>>::const_iterator found = lists.find(line);
+    if (found == lists.end()) {
+      return maxSteps;
+    }
+    const std::vector<int>& obstacles = found->second;
+    size_t distance;
+    if (increasing) {
+      std::vector<int>::const_iterator next = std::upper_bound(obstacles.begin(), obstacles.end(), start);
+      distance = next != obstacles.end() ? *next - start : obstacles.front() + length - start;
+    } else {
+      std::vector<int>::const_iterator next = std::lower_bound(obstacles.begin(), obstacles.end(), start);
+      distance = next != obstacles.begin() ? start - *(next - 1) : start + length - obstacles.back();
+    }
+    return distance <= maxSteps ? distance - 1 : maxSteps;
+  }
+};
+
+const uint64_t SparseObstacleStorage::EMPTY_KEY;
+const size_t SparseObstacleStorage::MIN_CAPACITY;
+
+/**
+ * A whole file mapped read-only into memory, unmapped again on destruction
+ **/
+class MappedFile {
+public:
+  /**
+   * Maps the given file
+   * Throws if it cannot be opened or mapped
+   **/
+  explicit MappedFile(const std::string& path) : data(nullptr), size(0) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Cannot open file: " + path);
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Cannot open file: " + path);
+    }
+    // An empty file cannot be mapped, and has no data to share anyway
+    if (status.st_size > 0) {
+      void* mapped = ::mmap(nullptr, (size_t) status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (mapped == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Cannot map file: " + path);
+      }
+      this->data = (const char*) mapped;
+      this->size = (size_t) status.st_size;
+    }
+    ::close(fd);
+  }
+
+  MappedFile(MappedFile&& other) noexcept : data(other.data), size(other.size) {
+    other.data = nullptr;
+    other.size = 0;
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (this->data != nullptr) {
+      ::munmap((void*) this->data, this->size);
+    }
+  }
+
+  /**
+   * GETTERS
+   **/
+  const char* getData() const { return this->data; }
+  size_t getSize() const { return this->size; }
+
+private:
+  const char* data;
+  size_t size;
+};
+
+/**
+ * GRID FILES
+ *
+ * A grid file is a 4 KiB header followed by the grid's two bitsets, each
+ * starting on a 4 KiB boundary so it can be mapped straight into memory:
+ *   - the row-major obstacle bitset, laid out exactly like DenseBitsetStorage
+ *   - the transposed, column-major bitset
+ * Words are stored in the byte order of the machine that wrote the file;
+ * byteOrderMark lets a reader on another machine reject it rather than
+ * misread it.
+ **/
+struct GridFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrderMark;
+  int32_t numRows;
+  int32_t numCols;
+  uint32_t wordsPerRow;
+  uint32_t wordsPerCol;
+  uint64_t numObstacles;
+  uint64_t rowWordsOffset;
+  uint64_t colWordsOffset;
+  uint64_t fileSize;
+};
+
+const char GRID_FILE_MAGIC[8] = {'R', 'O', 'V', 'R', 'G', 'R', 'I', 'D'};
+const uint32_t GRID_FILE_VERSION = 1;
+const uint32_t GRID_FILE_BYTE_ORDER_MARK = 0x01020304;
+const uint64_t GRID_FILE_ALIGNMENT = 4096;
+
+/**
+ * Read-only obstacle bitset mapped from a grid file
+ *
+ * Opening a file reads and checks the header and nothing else; the bitsets
+ * are paged in by the OS as rovers touch them, and every process mapping
+ * the same file shares the same physical pages. Obstacles cannot be added,
+ * so BasicGrid::putObstacle does not compile for this policy.
+ **/
+class MappedBitsetStorage {
+public:
+  static const int BITS_PER_WORD = 64;
+
+  /**
+   * Maps the given grid file
+   * Throws if it cannot be opened or is not a grid file this build can read
+   **/
+  explicit MappedBitsetStorage(const std::string& path) : file(path) {
+    const GridFileHeader* header = (const GridFileHeader*) this->file.getData();
+    if (this->file.getSize() < sizeof(GridFileHeader) || !isReadable(*header, this->file.getSize())) {
+      throw std::runtime_error("Not a grid file: " + path);
+    }
+    this->numRows = header->numRows;
+    this->numCols = header->numCols;
+    this->numObstacles = header->numObstacles;
+    this->wordsPerRow = (int) header->wordsPerRow;
+    this->wordsPerCol = (int) header->wordsPerCol;
+    this->obstacleWords = (const uint64_t*) (this->file.getData() + header->rowWordsOffset);
+    this->columnWords = (const uint64_t*) (this->file.getData() + header->colWordsOffset);
+  }
+
+  /**
+   * Dimensions and obstacle count recorded in the file
+   **/
+  int getNumRows() const { return this->numRows; }
+  int getNumCols() const { return this->numCols; }
+  size_t getNumObstacles() const { return (size_t) this->numObstacles; }
+
+  bool hasObstacle(int row, int col) const {
+    return ((getRowWords(row)[col / BITS_PER_WORD] >> (col % BITS_PER_WORD)) & 1) != 0;
+  }
+
+  size_t freeRunInRow(int row, int col, bool increasing, size_t maxSteps) const {
+    return freeRunAlongLine(getRowWords(row), this->numCols, col, increasing, maxSteps);
+  }
+
+  size_t freeRunInCol(int row, int col, bool increasing, size_t maxSteps) const {
+    return freeRunAlongLine(getColWords(col), this->numRows, row, increasing, maxSteps);
+  }
+
+  /**
+   * Raw bitset accessors, same layout as DenseBitsetStorage
+   **/
+  int getWordsPerRow() const { return this->wordsPerRow; }
+  const uint64_t* getObstacleWords() const { return this->obstacleWords; }
+  const uint64_t* getRowWords(int row) const {
+    return this->obstacleWords + (size_t) row * this->wordsPerRow;
+  }
+  int getWordsPerCol() const { return this->wordsPerCol; }
+  const uint64_t* getColWords(int col) const {
+    return this->columnWords + (size_t) col * this->wordsPerCol;
+  }
+
+private:
+  /**
+   * The whole grid file
+   **/
+  MappedFile file;
+
+  /**
+   * Copied out of the header
+   **/
+  int numRows, numCols;
+  uint64_t numObstacles;
+  int wordsPerRow, wordsPerCol;
+
+  /**
+   * The two bitsets, inside the mapping
+   **/
+  const uint64_t* obstacleWords;
+  const uint64_t* columnWords;
+
+  /**
+   * Checks that a header is one this build wrote and that the file holds everything it describes
+   **/
+  static bool isReadable(const GridFileHeader& header, uint64_t fileSize) {
+    if (std::memcmp(header.magic, GRID_FILE_MAGIC, sizeof(GRID_FILE_MAGIC)) != 0 ||
+        header.version != GRID_FILE_VERSION || header.byteOrderMark != GRID_FILE_BYTE_ORDER_MARK) {
+      return false;
+    }
+    if (header.numRows <= 0 || header.numCols <= 0 || header.fileSize != fileSize ||
+        header.wordsPerRow != ((uint64_t) header.numCols + BITS_PER_WORD - 1) / BITS_PER_WORD ||
+        header.wordsPerCol != ((uint64_t) header.numRows + BITS_PER_WORD - 1) / BITS_PER_WORD) {
+      return false;
+    }
+    uint64_t rowBytes = (uint64_t) header.numRows * header.wordsPerRow * sizeof(uint64_t);
+    uint64_t colBytes = (uint64_t) header.numCols * header.wordsPerCol * sizeof(uint64_t);
+    return header.rowWordsOffset % GRID_FILE_ALIGNMENT == 0 && header.colWordsOffset % GRID_FILE_ALIGNMENT == 0 &&
+           header.rowWordsOffset >= sizeof(GridFileHeader) && header.rowWordsOffset <= fileSize &&
+           rowBytes <= fileSize - header.rowWordsOffset && header.colWordsOffset <= fileSize &&
+           colBytes <= fileSize - header.colWordsOffset;
+  }
+};
+
+/**
+ * GRID TOPOLOGY POLICIES
+ *
+ * A topology policy decides what lies past the edges of the grid. Every policy provides
+ *   static const bool WRAPS_ROWS, WRAPS_COLS
+ *   static int rows(int numRows), static int cols(int numCols)
+ *   static int wrapRow(int row, int numRows)
+ *   static int wrapCol(int col, int numCols)
+ *   static int wrapStepRow(int row, int numRows)
+ *   static int wrapStepCol(int col, int numCols)
+ * where wrapping maps a coordinate one step past an edge back onto the grid.
+ * The wrapStep variants only accept coordinates at most one grid length
+ * outside the grid, which is all a unit step can produce, and wrap without dividing.
+ * Along an axis that does not wrap the coordinate is returned unchanged, so
+ * the cell past the edge is simply not in the grid and blocks like an obstacle.
+ * rows and cols give the grid's dimensions from the ones it was built with,
+ * which lets a policy replace them with compile-time constants.
+ **/
+
+/**
+ * Wraps both ways, like the original planet
+ **/
+struct TorusTopology {
+  static const bool WRAPS_ROWS = true;
+  static const bool WRAPS_COLS = true;
+  static int rows(int numRows) { return numRows; }
+  static int cols(int numCols) { return numCols; }
+  static int wrapRow(int row, int numRows) { return (row % numRows + numRows) % numRows; }
+  static int wrapCol(int col, int numCols) { return (col % numCols + numCols) % numCols; }
+  static int wrapStepRow(int row, int numRows) { return wrapStep(row, numRows); }
+  static int wrapStepCol(int col, int numCols) { return wrapStep(col, numCols); }
+
+  static int wrapStep(int value, int length) {
+    if (value < 0) {
+      return value + length;
+    }
+    return value >= length ? value - length : value;
+  }
+};
+
+/**
+ * A flat map with walls on all four edges
+ **/
+struct BoundedPlaneTopology {
+  static const bool WRAPS_ROWS = false;
+  static const bool WRAPS_COLS = false;
+  static int rows(int numRows) { return numRows; }
+  static int cols(int numCols) { return numCols; }
+  static int wrapRow(int row, int) { return row; }
+  static int wrapCol(int col, int) { return col; }
+  static int wrapStepRow(int row, int) { return row; }
+  static int wrapStepCol(int col, int) { return col; }
+};
+
+/**
+ * Wraps east-west only; the first and last rows are the poles
+ **/
+struct CylinderTopology {
+  static const bool WRAPS_ROWS = false;
+  static const bool WRAPS_COLS = true;
+  static int rows(int numRows) { return numRows; }
+  static int cols(int numCols) { return numCols; }
+  static int wrapRow(int row, int) { return row; }
+  static int wrapCol(int col, int numCols) { return (col % numCols + numCols) % numCols; }
+  static int wrapStepRow(int row, int) { return row; }
+  static int wrapStepCol(int col, int numCols) { return TorusTopology::wrapStep(col, numCols); }
+};
+
+/**
+ * A grid of Rows x Cols cells, fixed at compile time, that wraps like BaseTopology
+ *
+ * Wrapping divides by a constant instead of a loaded value, and when a
+ * dimension is a power of two it is a single mask. BasicGrid reads its
+ * dimensions and wraps through its topology, so every grid method gets the
+ * constant-size path, including when the grid is passed around as a BasicGrid.
+ **/
+template <int Rows, int Cols, class BaseTopology = TorusTopology>
+struct StaticTopology {
+  static_assert(Rows > 0 && Cols > 0, "StaticTopology dimensions must be positive");
+
+  typedef BaseTopology Base;
+  static const int ROWS = Rows;
+  static const int COLS = Cols;
+  static const bool WRAPS_ROWS = BaseTopology::WRAPS_ROWS;
+  static const bool WRAPS_COLS = BaseTopology::WRAPS_COLS;
+  static int rows(int) { return Rows; }
+  static int cols(int) { return Cols; }
+  static int wrapRow(int row, int) { return WRAPS_ROWS ? wrapConstant<Rows>(row) : row; }
+  static int wrapCol(int col, int) { return WRAPS_COLS ? wrapConstant<Cols>(col) : col; }
+  static int wrapStepRow(int row, int) { return WRAPS_ROWS ? wrapStepConstant<Rows>(row) : row; }
+  static int wrapStepCol(int col, int) { return WRAPS_COLS ? wrapStepConstant<Cols>(col) : col; }
+
+private:
+  /**
+   * Wraps any value onto [0, Length); two's complement makes the mask correct for negatives
+   **/
+  template <int Length>
+  static int wrapConstant(int value) {
+    if ((Length & (Length - 1)) == 0) {
+      return (int) ((unsigned) value & (unsigned) (Length - 1));
+    }
+    int wrapped = value % Length;
+    return wrapped < 0 ? wrapped + Length : wrapped;
+  }
+
+  template <int Length>
+  static int wrapStepConstant(int value) {
+    if ((Length & (Length - 1)) == 0) {
+      return (int) ((unsigned) value & (unsigned) (Length - 1));
+    }
+    return TorusTopology::wrapStep(value, Length);
+  }
+};
+
+// Represents a 2x2 grid of the planet
+template <class StoragePolicy, class TopologyPolicy = TorusTopology>
+class BasicGrid {
+public:
+  typedef StoragePolicy Storage;
+  typedef TopologyPolicy Topology;
+
+  /**
+   * Constructs a Grid object
+   *
+   * This object keeps track of what obstacles are currently on the grid.
+   * This object also handles wrapping around the planet, as set by the topology
+   **/
+  BasicGrid(int numRows, int numCols) : storage(numRows, numCols) {
+    this->numRows = numRows;
+    this->numCols = numCols;
+    this->numObstacles = 0;
+    this->epoch = 0;
+    this->isTrackingDirtyTiles = false;
+    this->numTileCols = 0;
+  }
+
+  /**
+   * Constructs a grid holding the obstacles of a packed bitmap
+   * The storage is not cleared first, since loading writes all of it.
+   * See DenseBitsetStorage::loadBitmap for the layout
+   **/
+  BasicGrid(int numRows, int numCols, const uint8_t* bitmap, size_t bytesPerRow)
+      : storage(numRows, numCols, typename StoragePolicy::Uninitialized()) {
+    this->numRows = numRows;
+    this->numCols = numCols;
+    this->epoch = 0;
+    this->isTrackingDirtyTiles = false;
+    this->numTileCols = 0;
+    this->numObstacles = this->storage.loadBitmap(bitmap, bytesPerRow);
+  }
+
+  /**
+   * Constructs a grid around storage that already holds a planet, such as a mapped grid file
+   **/
+  explicit BasicGrid(StoragePolicy&& filledStorage) : storage(std::move(filledStorage)) {
+    this->numRows = this->storage.getNumRows();
+    this->numCols = this->storage.getNumCols();
+    this->numObstacles = this->storage.getNumObstacles();
+    this->epoch = 0;
+    this->isTrackingDirtyTiles = false;
+    this->numTileCols = 0;
+  }
+
+  /**
+   * GETTERS
+   **/
+  int getNumRows() const { return TopologyPolicy::rows(this->numRows); }
+  int getNumCols() const { return TopologyPolicy::cols(this->numCols); }
+  size_t getNumObstacles() const { return this->numObstacles; }
+  const StoragePolicy& getStorage() const { return this->storage; }
+
+  /**
+   * Counts changes to the obstacle map; goes up by at least one whenever
+   * obstacles are placed or removed, and never goes down
+   * Anything derived from the grid can compare epochs to tell whether it is stale
+   **/
+  uint64_t getEpoch() const { return this->epoch; }
+
+  /**
+   * Raw bitset accessors, only available with DenseBitsetStorage
+   * See DenseBitsetStorage for the layout
+   **/
+  int getWordsPerRow() const { return this->storage.getWordsPerRow(); }
+  const uint64_t* getObstacleWords() const { return this->storage.getObstacleWords(); }
+  const uint64_t* getRowWords(int row) const { return this->storage.getRowWords(row); }
+  int getWordsPerCol() const { return this->storage.getWordsPerCol(); }
+  const uint64_t* getColWords(int col) const { return this->storage.getColWords(col); }
+
+  /**
+   * Places an obstacle at the given row and column
+   **/
+  void putObstacle(int row, int col) {
+    if (isValidLocation(row, col)) {
+      this->numObstacles++;
+      this->storage.setObstacle(row, col);
+      recordChange(row, col);
+    }
+  }
+
+  /**
+   * Clears the obstacle at the given row and column, if there is one
+   **/
+  void removeObstacle(int row, int col) {
+    if (isInGrid(row, col) && this->storage.hasObstacle(row, col)) {
+      this->numObstacles--;
+      this->storage.clearObstacle(row, col);
+      recordChange(row, col);
+    }
+  }
+
+  /**
+   * Places obstacles at every given (row, col) cell, skipping cells outside the grid
+   * Dense grids are filled on up to numThreads threads
+   **/
+  void putObstacles(const std::vector<std::pair<int, int>>& cells, unsigned numThreads = 1) {
+    size_t numSet = this->storage.setObstacles(cells.data(), cells.size(), numThreads);
+    if (numSet > 0) {
+      this->numObstacles += numSet;
+      this->epoch++;
+      if (this->isTrackingDirtyTiles) {
+        // Marks the tiles of cells that were already obstacles too, which is harmless
+        for (const std::pair<int, int>& cell : cells) {
+          if (isInGrid(cell.first, cell.second)) {
+            markTileDirty(cell.first / DIRTY_TILE_SIZE, cell.second / DIRTY_TILE_SIZE);
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Places obstacles on every cell from (firstRow, firstCol) to (lastRow, lastCol) inclusive
+   * The rectangle is clipped to the grid rather than wrapped around it
+   **/
+  void putObstacleRect(int firstRow, int firstCol, int lastRow, int lastCol) {
+    firstRow = std::max(firstRow, 0);
+    firstCol = std::max(firstCol, 0);
+    lastRow = std::min(lastRow, this->numRows - 1);
+    lastCol = std::min(lastCol, this->numCols - 1);
+    if (firstRow <= lastRow && firstCol <= lastCol) {
+      size_t numSet = this->storage.setObstacleRect(firstRow, firstCol, lastRow, lastCol);
+      if (numSet > 0) {
+        this->numObstacles += numSet;
+        markRectChanged(firstRow, firstCol, lastRow, lastCol);
+      }
+    }
+  }
+
+  /**
+   * Replaces every obstacle with the set bits of a packed bitmap
+   * See DenseBitsetStorage::loadBitmap for the layout
+   **/
+  void loadBitmap(const uint8_t* bitmap, size_t bytesPerRow) {
+    this->numObstacles = this->storage.loadBitmap(bitmap, bytesPerRow);
+    markRectChanged(0, 0, this->numRows - 1, this->numCols - 1);
+  }
+
+  /**
+   * Side of the square tiles that dirty tracking works in
+   **/
+  static const int DIRTY_TILE_SIZE = 64;
+
+  /**
+   * Starts recording which DIRTY_TILE_SIZE x DIRTY_TILE_SIZE tiles of the grid
+   * have changed, one bit per tile, so that caches built on the grid can be
+   * updated tile by tile rather than rebuilt. Tiles changed before this call
+   * are not recorded
+   **/
+  void enableDirtyTracking() {
+    if (!this->isTrackingDirtyTiles) {
+      this->isTrackingDirtyTiles = true;
+      this->numTileCols = (this->numCols + DIRTY_TILE_SIZE - 1) / DIRTY_TILE_SIZE;
+      size_t numTiles = (size_t) ((this->numRows + DIRTY_TILE_SIZE - 1) / DIRTY_TILE_SIZE) * this->numTileCols;
+      this->dirtyTiles.assign((numTiles + 63) / 64, 0);
+    }
+  }
+
+  /**
+   * Whether any cell of the given tile has changed since dirty tiles were last taken
+   **/
+  bool isTileDirty(int tileRow, int tileCol) const {
+    if (!this->isTrackingDirtyTiles) {
+      return false;
+    }
+    size_t tile = (size_t) tileRow * this->numTileCols + tileCol;
+    return ((this->dirtyTiles[tile / 64] >> (tile % 64)) & 1) != 0;
+  }
+
+  /**
+   * Returns the (tileRow, tileCol) of every dirty tile, in row-major order, and marks them all clean
+   **/
+  std::vector<std::pair<int, int>> takeDirtyTiles() {
+    std::vector<std::pair<int, int>> tiles;
+    for (size_t i = 0; i < this->dirtyTiles.size(); i++) {
+      for (uint64_t word = this->dirtyTiles[i]; word != 0; word &= word - 1) {
+        size_t tile = i * 64 + countTrailingZeros(word);
+        tiles.push_back(std::make_pair((int) (tile / this->numTileCols), (int) (tile % this->numTileCols)));
+      }
+      this->dirtyTiles[i] = 0;
+    }
+    return tiles;
+  }
+
+  /**
+   * Makes rovers placed on this grid from now on treat each other as obstacles
+   * Copies of the grid share the same rovers. The layer only allocates the
+   * tiles rovers visit, so this is cheap on planets of any size
+   **/
+  void enableRoverOccupancy() {
+    if (!this->occupancy) {
+      this->occupancy = std::make_shared<OccupancyLayer>(this->numRows, this->numCols);
+    }
+  }
+
+  /**
+   * Layer tracking where rovers are, or nullptr if rovers ignore each other
+   **/
+  OccupancyLayer* getOccupancy() const { return this->occupancy.get(); }
+
+  /**
+   * Counts how many cells a rover at (row, col) can travel along its row,
+   * wrapping around the planet, before the next cell would be an obstacle or
+   * off the edge.
+   * Looks towards higher columns when increasing is true, lower columns otherwise.
+   * At most maxSteps cells are scanned; maxSteps is returned if none are blocked
+   **/
+  size_t freeRunInRow(int row, int col, bool increasing, size_t maxSteps) const {
+    if (!TopologyPolicy::WRAPS_COLS) {
+      maxSteps = std::min<size_t>(maxSteps, increasing ? this->numCols - 1 - col : col);
+    }
+    return this->storage.freeRunInRow(row, col, increasing, maxSteps);
+  }
+
+  /**
+   * Same as freeRunInRow, but along the rover's column
+   **/
+  size_t freeRunInCol(int row, int col, bool increasing, size_t maxSteps) const {
+    if (!TopologyPolicy::WRAPS_ROWS) {
+      maxSteps = std::min<size_t>(maxSteps, increasing ? this->numRows - 1 - row : row);
+    }
+    return this->storage.freeRunInCol(row, col, increasing, maxSteps);
+  }
+
+  /**
+   * Checks whether the given row and column location is within the grid
+   * and has no obstacles
+   **/
+  bool isValidLocation(int row, int col) const {
+    if (isInGrid(row, col)) {
+      return !this->storage.hasObstacle(row, col);
+    } else {
+      return false;
+    }
+  }
+
+  /**
+   * Checks if the given row and col is within the dimensions of the grid
+   **/
+  bool isInGrid(int row, int col) const {
+    if (row < 0 || col < 0) {
+      return false;
+    } else if (row >= getNumRows()) {
+      return false;
+    } else if (col >= getNumCols()) {
+      return false;
+    } else {
+      return true;
+    }
+  }
+
+  /**
+   * Converts a row to a corresponding row on the grid (i.e. wrapping)
+   * Example: row 4 on a 3 row grid would return row 0
+   **/
+  int convertToGridRow(int row) const {
+    return TopologyPolicy::wrapRow(row, this->getNumRows());
+  }
+
+  /**
+   * Converts a col to a corresponding col on the grid (i.e. wrapping)
+   **/
+  int convertToGridCol(int col) const {
+    return TopologyPolicy::wrapCol(col, this->getNumCols());
+  }
+
+  /**
+   * Wraps a row that is at most one grid length off the grid, as after a unit step
+   * Cheaper than convertToGridRow since it never divides
+   **/
+  int wrapStepRow(int row) const {
+    return TopologyPolicy::wrapStepRow(row, this->getNumRows());
+  }
+
+  /**
+   * Wraps a col that is at most one grid length off the grid, as after a unit step
+   **/
+  int wrapStepCol(int col) const {
+    return TopologyPolicy::wrapStepCol(col, this->getNumCols());
+  }
+
+private:
+  /**
+   * Notes a change to a single cell
+   **/
+  void recordChange(int row, int col) {
+    this->epoch++;
+    if (this->isTrackingDirtyTiles) {
+      markTileDirty(row / DIRTY_TILE_SIZE, col / DIRTY_TILE_SIZE);
+    }
+  }
+
+  /**
+   * Notes a change somewhere in the given rectangle of cells
+   **/
+  void markRectChanged(int firstRow, int firstCol, int lastRow, int lastCol) {
+    this->epoch++;
+    if (this->isTrackingDirtyTiles) {
+      for (int tileRow = firstRow / DIRTY_TILE_SIZE; tileRow <= lastRow / DIRTY_TILE_SIZE; tileRow++) {
+        for (int tileCol = firstCol / DIRTY_TILE_SIZE; tileCol <= lastCol / DIRTY_TILE_SIZE; tileCol++) {
+          markTileDirty(tileRow, tileCol);
+        }
+      }
+    }
+  }
+
+  void markTileDirty(int tileRow, int tileCol) {
+    size_t tile = (size_t) tileRow * this->numTileCols + tileCol;
+    this->dirtyTiles[tile / 64] |= (uint64_t) 1 << (tile % 64);
+  }
+
+  /**
+   * Dimensions of the grid
+   **/
+  int numRows, numCols;
+
+  /**
+   * Number of cells holding an obstacle
+   **/
+  size_t numObstacles;
+
+  /**
+   * See getEpoch
+   **/
+  uint64_t epoch;
+
+  /**
+   * One bit per tile, row-major with numTileCols tiles per row, when tracking
+   **/
+  bool isTrackingDirtyTiles;
+  int numTileCols;
+  std::vector<uint64_t> dirtyTiles;
+
+  /**
+   * Where the obstacles are
+   **/
+  StoragePolicy storage;
+
+  /**
+   * Cells currently taken by rovers, when enabled
+   **/
+  std::shared_ptr<OccupancyLayer> occupancy;
+};
+
+template <class StoragePolicy, class TopologyPolicy>
+const int BasicGrid<StoragePolicy, TopologyPolicy>::DIRTY_TILE_SIZE;
+
+/**
+ * A grid whose dimensions are fixed at compile time
+ * A BasicGrid on a StaticTopology, so the constant-size wraps are used by every
+ * method of the grid, whether it is reached as a StaticGrid or through a
+ * reference to its BasicGrid. Rovers take it as their GridType like any other grid.
+ **/
+template <int Rows, int Cols, class StoragePolicy = DenseBitsetStorage, class TopologyPolicy = TorusTopology>
+class StaticGrid : public BasicGrid<StoragePolicy, StaticTopology<Rows, Cols, TopologyPolicy> > {
+public:
+  StaticGrid() : BasicGrid<StoragePolicy, StaticTopology<Rows, Cols, TopologyPolicy> >(Rows, Cols) {}
+};
+
+/**
+ * The default grid, a dense bitset
+ **/
+typedef BasicGrid<DenseBitsetStorage> Grid;
+
+/**
+ * A grid for planets too big to hold as one bitset
+ **/
+typedef BasicGrid<TiledBitsetStorage> TiledGrid;
+
+/**
+ * A grid for huge planets with few obstacles
+ **/
+typedef BasicGrid<SparseObstacleStorage> SparseGrid;
+
+/**
+ * A read-only grid mapped from a grid file
+ **/
+typedef BasicGrid<MappedBitsetStorage> MappedGrid;
+
+/**
+ * Writes a grid in the grid file format, ready to be mapped with openGridFile
+ * Throws if the file cannot be written
+ **/
+template <class TopologyPolicy>
+void writeGridFile(const BasicGrid<DenseBitsetStorage, TopologyPolicy>& grid, const std::string& path) {
+  uint64_t rowBytes = (uint64_t) grid.getNumRows() * grid.getWordsPerRow() * sizeof(uint64_t);
+  uint64_t colBytes = (uint64_t) grid.getNumCols() * grid.getWordsPerCol() * sizeof(uint64_t);
+
+  GridFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, GRID_FILE_MAGIC, sizeof(GRID_FILE_MAGIC));
+  header.version = GRID_FILE_VERSION;
+  header.byteOrderMark = GRID_FILE_BYTE_ORDER_MARK;
+  header.numRows = grid.getNumRows();
+  header.numCols = grid.getNumCols();
+  header.wordsPerRow = grid.getWordsPerRow();
+  header.wordsPerCol = grid.getWordsPerCol();
+  header.numObstacles = grid.getNumObstacles();
+  header.rowWordsOffset = GRID_FILE_ALIGNMENT;
+  header.colWordsOffset = header.rowWordsOffset + (rowBytes + GRID_FILE_ALIGNMENT - 1) / GRID_FILE_ALIGNMENT * GRID_FILE_ALIGNMENT;
+  header.fileSize = header.colWordsOffset + colBytes;
+
+  std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+  std::vector<char> padding(GRID_FILE_ALIGNMENT, 0);
+  file.write((const char*) &header, sizeof(header));
+  file.write(padding.data(), header.rowWordsOffset - sizeof(header));
+  file.write((const char*) grid.getObstacleWords(), rowBytes);
+  file.write(padding.data(), header.colWordsOffset - header.rowWordsOffset - rowBytes);
+  file.write((const char*) grid.getColWords(0), colBytes);
+  file.close();
+  if (!file) {
+    throw std::runtime_error("Cannot write grid file: " + path);
+  }
+}
+
+/**
+ * Opens a grid file for any number of rovers to share
+ * Only the header is read; see MappedBitsetStorage
+ **/
+inline std::shared_ptr<const MappedGrid> openGridFile(const std::string& path) {
+  return std::make_shared<const MappedGrid>(MappedBitsetStorage(path));
+}
+
+/**
+ * PBM BITMAPS
+ *
+ * Obstacle maps exchanged as binary PBM (P4) images: a short text header
+ * giving the width and height, then one row after another, each padded to
+ * whole bytes with the leftmost pixel in the most significant bit. Black
+ * (set) pixels are obstacles.
+ **/
+
+/**
+ * Reads the next number of a PBM header, skipping whitespace and # comments
+ * Returns false if there is no number there or it does not fit in an int
+ **/
+inline bool readPbmNumber(const char* data, size_t size, size_t& offset, int& value) {
+  while (offset < size && (std::isspace((unsigned char) data[offset]) || data[offset] == '#')) {
+    if (data[offset] == '#') {
+      while (offset < size && data[offset] != '\n') {
+        offset++;
+      }
+    } else {
+      offset++;
+    }
+  }
+  long long number = 0;
+  size_t start = offset;
+  while (offset < size && std::isdigit((unsigned char) data[offset])) {
+    number = number * 10 + (data[offset] - '0');
+    if (number > INT32_MAX) {
+      return false;
+    }
+    offset++;
+  }
+  value = (int) number;
+  return offset > start;
+}
+
+/**
+ * Loads a P4 PBM file as a new grid
+ *
+ * The file is mapped rather than read, and its rows are converted straight
+ * into the grid's bitset a word at a time, with no per-cell work.
+ * Throws if the file cannot be opened or is not a P4 PBM file
+ **/
+inline std::shared_ptr<Grid> readPbmFile(const std::string& path) {
+  MappedFile file(path);
+  const char* data = file.getData();
+  size_t size = file.getSize();
+  size_t offset = 2;
+  int numCols, numRows;
+  if (size < 2 || data[0] != 'P' || data[1] != '4' || !readPbmNumber(data, size, offset, numCols) ||
+      !readPbmNumber(data, size, offset, numRows) || numCols == 0 || numRows == 0 ||
+      offset >= size || !std::isspace((unsigned char) data[offset])) {
+    throw std::runtime_error("Not a PBM (P4) file: " + path);
+  }
+  // A single whitespace character separates the header from the pixels
+  offset++;
+  size_t bytesPerRow = ((size_t) numCols + 7) / 8;
+  if ((size - offset) / bytesPerRow < (size_t) numRows) {
+    throw std::runtime_error("Not a PBM (P4) file: " + path);
+  }
+
+  return std::make_shared<Grid>(numRows, numCols, (const uint8_t*) data + offset, bytesPerRow);
+}
+
+/**
+ * Writes the obstacles of a grid as a P4 PBM file that readPbmFile loads back
+ * Throws if the file cannot be written
+ **/
+template <class TopologyPolicy>
+void writePbmFile(const BasicGrid<DenseBitsetStorage, TopologyPolicy>& grid, const std::string& path) {
+  std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+  file << "P4\n" << grid.getNumCols() << " " << grid.getNumRows() << "\n";
+  size_t bytesPerRow = ((size_t) grid.getNumCols() + 7) / 8;
+  std::vector<char> rowBytes((size_t) grid.getWordsPerRow() * 8);
+  for (int row = 0; row < grid.getNumRows(); row++) {
+    const uint64_t* words = grid.getRowWords(row);
+    for (int i = 0; i < grid.getWordsPerRow(); i++) {
+      uint64_t word = reverseBitsInEachByte(words[i]);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      word = __builtin_bswap64(word);
+#endif
+      std::memcpy(rowBytes.data() + (size_t) i * 8, &word, 8);
+    }
+    file.write(rowBytes.data(), bytesPerRow);
+  }
+  file.close();
+  if (!file) {
+    throw std::runtime_error("Cannot write PBM file: " + path);
+  }
+}
+
+/**
+ * Gray levels of a trajectory overlay
+ **/
+const unsigned char OVERLAY_FREE = 255;
+const unsigned char OVERLAY_TRAJECTORY = 128;
+const unsigned char OVERLAY_OBSTACLE = 0;
+
+/**
+ * Writes a grid with a rover's trajectory drawn over it, for viewing
+ *
+ * A 1-bit PBM cannot tell the trajectory from the obstacles, so this writes
+ * a binary PGM (P5) image instead: obstacles black, cells in trajectory
+ * gray, everything else white. Cells are (row, col) pairs, in any order.
+ * Throws if the file cannot be written
+ **/
+template <class TopologyPolicy>
+void writeTrajectoryOverlay(const BasicGrid<DenseBitsetStorage, TopologyPolicy>& grid,
+                            const std::vector<std::pair<int, int>>& trajectory, const std::string& path) {
+  std::vector<std::pair<int, int>> cells(trajectory);
+  std::sort(cells.begin(), cells.end());
+  std::vector<std::pair<int, int>>::const_iterator cell = cells.begin();
+
+  std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+  file << "P5\n" << grid.getNumCols() << " " << grid.getNumRows() << "\n255\n";
+  std::vector<unsigned char> pixels(grid.getNumCols());
+  for (int row = 0; row < grid.getNumRows(); row++) {
+    const uint64_t* words = grid.getRowWords(row);
+    for (int col = 0; col < grid.getNumCols(); col++) {
+      bool isObstacle = ((words[col / 64] >> (col % 64)) & 1) != 0;
+      pixels[col] = isObstacle ? OVERLAY_OBSTACLE : OVERLAY_FREE;
+    }
+    for (; cell != cells.end() && cell->first <= row; ++cell) {
+      if (cell->first == row && grid.isInGrid(cell->first, cell->second)) {
+        pixels[cell->second] = OVERLAY_TRAJECTORY;
+      }
+    }
+    file.write((const char*) pixels.data(), pixels.size());
+  }
+  file.close();
+  if (!file) {
+    throw std::runtime_error("Cannot write trajectory overlay: " + path);
+  }
+}
+
+/**
+ * Publishes new versions of a grid to reader threads without reader locks
+ *
+ * Read-copy-update with epoch-based reclamation. A writer copies the current
+ * version, edits the copy and swaps it in with one atomic store; readers
+ * never block and always see one complete version. A replaced version is
+ * freed once no reader that might still be looking at it is left. Entering
+ * a read costs one store and one load, and lookups inside it are plain
+ * reads, so readers run at full speed when nothing is being written.
+ *
+ * Works with any grid type; TiledGrid makes each update cost only the tiles
+ * it changes, as versions share everything else.
+ **/
+template <class GridType>
+class GridPublisher {
+public:
+  /**
+   * Keeps a grid pinned for as long as it exists
+   * Rovers built on getGrid() must not outlive it
+   **/
+  class ReadGuard {
+  public:
+    ReadGuard(ReadGuard&& other) noexcept : epoch(other.epoch), grid(other.grid) {
+      other.epoch = nullptr;
+    }
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+
+    ~ReadGuard() {
+      if (this->epoch != nullptr) {
+        this->epoch->store(0, std::memory_order_release);
+      }
+    }
+
+    const GridType& operator*() const { return *this->grid; }
+    const GridType* operator->() const { return this->grid; }
+
+    /**
+     * The pinned grid as a non-owning pointer, for constructing rovers
+     **/
+    std::shared_ptr<const GridType> getGrid() const {
+      return std::shared_ptr<const GridType>(std::shared_ptr<const GridType>(), this->grid);
+    }
+
+  private:
+    friend class GridPublisher;
+
+    ReadGuard(std::atomic<uint64_t>* epoch, const GridType* grid) : epoch(epoch), grid(grid) {}
+
+    std::atomic<uint64_t>* epoch;
+    const GridType* grid;
+  };
+
+  /**
+   * Publishes a copy of the given grid, for up to maxReaders reader threads
+   **/
+  GridPublisher(const GridType& initial, unsigned maxReaders)
+      : maxReaders(maxReaders), globalEpoch(1), readers(new ReaderSlot[maxReaders]),
+        currentOwner(new GridType(initial)), current(currentOwner.get()) {
+    for (unsigned i = 0; i < maxReaders; i++) {
+      this->readers[i].epoch.store(0);
+    }
+  }
+
+  GridPublisher(const GridPublisher&) = delete;
+  GridPublisher& operator=(const GridPublisher&) = delete;
+
+  unsigned getMaxReaders() const { return this->maxReaders; }
+
+  /**
+   * Pins the current version for reading
+   * Every thread reading at the same time passes its own reader index, below
+   * getMaxReaders(), and holds at most one guard at a time
+   **/
+  ReadGuard read(unsigned reader) {
+    std::atomic<uint64_t>& epoch = this->readers[reader].epoch;
+    // Announce before loading, so a writer either sees this reader or this reader sees its version.
+    // The epoch load must acquire: a reader that sees epoch R + 1 synchronises with the
+    // writer's fetch_add and so also sees the version stored before it. A relaxed load could
+    // pair R + 1 with the old version, which the writer frees as soon as it sees R + 1
+    epoch.store(this->globalEpoch.load(std::memory_order_acquire), std::memory_order_seq_cst);
+    return ReadGuard(&epoch, this->current.load(std::memory_order_seq_cst));
+  }
+
+  /**
+   * Publishes a new version made by calling edit on a copy of the current one
+   * Writers are serialised; readers are never blocked
+   **/
+  template <typename Edit>
+  void update(const Edit& edit) {
+    std::lock_guard<std::mutex> lock(this->writerMutex);
+    std::unique_ptr<GridType> next(new GridType(*this->currentOwner));
+    edit(*next);
+    this->current.store(next.get(), std::memory_order_seq_cst);
+    // Only readers that announced an epoch up to this one can still hold the old version
+    uint64_t retireEpoch = this->globalEpoch.fetch_add(1, std::memory_order_seq_cst);
+    this->retired.push_back(std::make_pair(retireEpoch, std::move(this->currentOwner)));
+    this->currentOwner = std::move(next);
+    reclaim();
+  }
+
+  /**
+   * Replaced versions not yet freed because readers may still be using them
+   **/
+  size_t getNumRetired() {
+    std::lock_guard<std::mutex> lock(this->writerMutex);
+    reclaim();
+    return this->retired.size();
+  }
+
+private:
+  /**
+   * Epoch a reader announced on entering, or 0 when it is not reading
+   * Padded so readers never share a cache line
+   **/
+  struct ReaderSlot {
+    std::atomic<uint64_t> epoch;
+    char padding[64 - sizeof(std::atomic<uint64_t>)];
+  };
+
+  unsigned maxReaders;
+  std::atomic<uint64_t> globalEpoch;
+  std::unique_ptr<ReaderSlot[]> readers;
+
+  /**
+   * The published version, and the writer's handle on it
+   **/
+  std::unique_ptr<GridType> currentOwner;
+  std::atomic<const GridType*> current;
+
+  /**
+   * Replaced versions, with the epoch they were replaced in
+   **/
+  std::mutex writerMutex;
+  std::vector<std::pair<uint64_t, std::unique_ptr<GridType>>> retired;
+
+  /**
+   * Frees every retired version that no active reader can still see
+   **/
+  void reclaim() {
+    uint64_t oldestReader = UINT64_MAX;
+    for (unsigned i = 0; i < this->maxReaders; i++) {
+      uint64_t epoch = this->readers[i].epoch.load(std::memory_order_seq_cst);
+      if (epoch != 0) {
+        oldestReader = std::min(oldestReader, epoch);
+      }
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < this->retired.size(); i++) {
+      if (this->retired[i].first >= oldestReader) {
+        this->retired[kept++] = std::move(this->retired[i]);
+      }
+    }
+    this->retired.erase(this->retired.begin() + kept, this->retired.end());
+  }
+};
+
+/**
+ * Represents the four cardinal directions
+ **/
+enum Direction {
+  NORTH = 0,
+  EAST = 1,
+  SOUTH = 2,
+  WEST = 3
+};
+
+/**
+ * Forward movement for each cardinal direction, as a row and a col step
+ **/
+constexpr int DIRECTION_ROW_STEP[4] = { 1, 0, -1, 0 };
+constexpr int DIRECTION_COL_STEP[4] = { 0, 1, 0, -1 };
+
+/**
+ * What one command byte does to a rover facing a given direction
+ * rowStep/colStep are the unit move, zero for rotations. dir is the heading
+ * afterwards. Bytes other than 'F', 'B', 'L', 'R' leave everything unchanged
+ * and have isValid cleared.
+ **/
+struct CommandStep {
+  int8_t rowStep;
+  int8_t colStep;
+  uint8_t dir;
+  uint8_t isValid;
+};
+
+/**
+ * Every (direction, command byte) transition, precomputed
+ * Decoding a command is one load with no branches on the command
+ **/
+class CommandTable {
+public:
+  CommandTable() {
+    for (int dir = NORTH; dir <= WEST; dir++) {
+      for (int command = 0; command < 256; command++) {
+        CommandStep& step = this->steps[dir][command];
+        step.rowStep = 0;
+        step.colStep = 0;
+        step.dir = (uint8_t) dir;
+        step.isValid = 1;
+        if (command == 'F' || command == 'B') {
+          int sign = command == 'F' ? 1 : -1;
+          step.rowStep = (int8_t) (sign * DIRECTION_ROW_STEP[dir]);
+          step.colStep = (int8_t) (sign * DIRECTION_COL_STEP[dir]);
+        } else if (command == 'L') {
+          step.dir = (uint8_t) ((dir + 3) % 4);
+        } else if (command == 'R') {
+          step.dir = (uint8_t) ((dir + 1) % 4);
+        } else {
+          step.isValid = 0;
+        }
+      }
+    }
+  }
+
+  const CommandStep& decode(int dir, char command) const {
+    return this->steps[dir][(unsigned char) command];
+  }
+
+private:
+  /**
+   * Indexed by [direction][command byte]
+   **/
+  CommandStep steps[4][256];
+};
+
+const CommandTable COMMAND_TABLE;
+
+/**
+ * Direction faced after rotating left/right from the given direction
+ **/
+inline Direction rotateDirection(Direction dir, bool isRotateLeft) {
+  return (Direction) COMMAND_TABLE.decode(dir, isRotateLeft ? 'L' : 'R').dir;
+}
+
+/**
+ * VECTORIZED KERNEL SELECTION
+ *
+ * Hot loops that have SIMD versions take a StepKernel saying which one to run.
+ * Every kernel gives exactly the same result as the scalar one.
+ **/
+
+/**
+ * Instruction sets the vectorized kernels are written for
+ **/
+enum StepKernel {
+  KERNEL_SCALAR = 0,
+  KERNEL_SSE42 = 1,
+  KERNEL_AVX2 = 2
+};
+
+/**
+ * Whether the running CPU can execute the given kernel
+ **/
+inline bool isStepKernelSupported(StepKernel kernel) {
+  switch (kernel) {
+    case KERNEL_SCALAR: {
+      return true;
+    }
+#ifdef ROVER_X86_KERNELS
+    case KERNEL_SSE42: {
+      return __builtin_cpu_supports("sse4.2");
+    }
+    case KERNEL_AVX2: {
+      return __builtin_cpu_supports("avx2");
+    }
+#endif
+    default: {
+      return false;
+    }
+  }
+}
+
+/**
+ * Fastest kernel the running CPU supports, detected once
+ **/
+inline StepKernel bestStepKernel() {
+  static const StepKernel best = isStepKernelSupported(KERNEL_AVX2) ? KERNEL_AVX2
+                               : isStepKernelSupported(KERNEL_SSE42) ? KERNEL_SSE42
+                               : KERNEL_SCALAR;
+  return best;
+}
+
+/**
+ * COMMAND VALIDATION KERNELS
+ *
+ * Check a whole command string for bytes other than 'F', 'B', 'L', 'R' before
+ * anything runs it, counting each kind of command on the way.
+ **/
+
+/**
+ * A borrowed command string
+ * Literals, strings and slices of larger buffers are all taken without
+ * copying. std::string_view when built as C++17, and a pointer and length
+ * with the same interface before that
+ **/
+#if __cplusplus >= 201703L
+typedef std::string_view CommandText;
+#else
+class CommandText {
+public:
+  CommandText(const char* characters) : characters(characters), length(std::strlen(characters)) {}
+  CommandText(const std::string& movements) : characters(movements.data()), length(movements.size()) {}
+  CommandText(const char* characters, size_t length) : characters(characters), length(length) {}
+
+  /**
+   * GETTERS
+   **/
+  const char* data() const { return this->characters; }
+  size_t size() const { return this->length; }
+  const char* begin() const { return this->characters; }
+  const char* end() const { return this->characters + this->length; }
+  char operator[](size_t index) const { return this->characters[index]; }
+
+private:
+  /**
+   * First command, owned by the caller
+   **/
+  const char* characters;
+
+  /**
+   * Number of commands
+   **/
+  size_t length;
+};
+#endif
+
+/**
+ * Outcome of validateCommands
+ *
+ * firstInvalid is the offset of the first byte that is not a command, or the
+ * length of the string when every byte is one. The counts cover the commands
+ * before firstInvalid.
+ **/
+struct CommandCounts {
+  size_t numForward, numBackward, numLeft, numRight;
+  size_t firstInvalid;
+};
+
+/**
+ * Scalar kernel, counting [begin, end) into counts
+ * Returns false at the first invalid byte, recording its offset from base
+ **/
+inline bool countCommandsScalar(const char* base, const char* begin, const char* end, CommandCounts& counts) {
+  for (const char* command = begin; command != end; command++) {
+    switch (*command) {
+      case 'F': {
+        counts.numForward++;
+        break;
+      }
+      case 'B': {
+        counts.numBackward++;
+        break;
+      }
+      case 'L': {
+        counts.numLeft++;
+        break;
+      }
+      case 'R': {
+        counts.numRight++;
+        break;
+      }
+      default: {
+        counts.firstInvalid = command - base;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+#ifdef ROVER_X86_KERNELS
+/**
+ * SSE4.2 kernel, 16 bytes at a time
+ * Matches are counted in byte lanes and widened with a sum of absolute
+ * differences every 255 blocks, before a lane can overflow
+ **/
+__attribute__((target("sse4.2")))
+inline void countCommandsSse42(const char* tape, size_t length, CommandCounts& counts) {
+  const __m128i forward = _mm_set1_epi8('F');
+  const __m128i backward = _mm_set1_epi8('B');
+  const __m128i left = _mm_set1_epi8('L');
+  const __m128i right = _mm_set1_epi8('R');
+  const __m128i zero = _mm_setzero_si128();
+
+  size_t i = 0;
+  while (i + 16 <= length) {
+    __m128i forwardLanes = zero, backwardLanes = zero, leftLanes = zero;
+    size_t batchEnd = std::min(length - length % 16, i + 255 * 16);
+    for (; i < batchEnd; i += 16) {
+      __m128i bytes = _mm_loadu_si128((const __m128i*) (tape + i));
+      __m128i isForward = _mm_cmpeq_epi8(bytes, forward);
+      __m128i isBackward = _mm_cmpeq_epi8(bytes, backward);
+      __m128i isLeft = _mm_cmpeq_epi8(bytes, left);
+      __m128i isRight = _mm_cmpeq_epi8(bytes, right);
+      __m128i isValid = _mm_or_si128(_mm_or_si128(isForward, isBackward), _mm_or_si128(isLeft, isRight));
+      if (_mm_movemask_epi8(isValid) != 0xFFFF) {
+        break;
+      }
+      // A match is -1, so subtracting counts it
+      forwardLanes = _mm_sub_epi8(forwardLanes, isForward);
+      backwardLanes = _mm_sub_epi8(backwardLanes, isBackward);
+      leftLanes = _mm_sub_epi8(leftLanes, isLeft);
+    }
+    __m128i forwardSums = _mm_sad_epu8(forwardLanes, zero);
+    __m128i backwardSums = _mm_sad_epu8(backwardLanes, zero);
+    __m128i leftSums = _mm_sad_epu8(leftLanes, zero);
+    size_t numForward = (uint32_t) _mm_cvtsi128_si32(_mm_add_epi64(forwardSums, _mm_unpackhi_epi64(forwardSums, forwardSums)));
+    size_t numBackward = (uint32_t) _mm_cvtsi128_si32(_mm_add_epi64(backwardSums, _mm_unpackhi_epi64(backwardSums, backwardSums)));
+    size_t numLeft = (uint32_t) _mm_cvtsi128_si32(_mm_add_epi64(leftSums, _mm_unpackhi_epi64(leftSums, leftSums)));
+    counts.numForward += numForward;
+    counts.numBackward += numBackward;
+    counts.numLeft += numLeft;
+    counts.numRight += (i - counts.firstInvalid) - numForward - numBackward - numLeft;
+    counts.firstInvalid = i;
+    if (i < batchEnd) {
+      break;
+    }
+  }
+  if (countCommandsScalar(tape, tape + i, tape + length, counts)) {
+    counts.firstInvalid = length;
+  }
+}
+
+/**
+ * Total of the four 64-bit lanes of a sum of absolute differences
+ **/
+__attribute__((target("avx2")))
+inline size_t sumAbsoluteDifferenceLanes(__m256i sums) {
+  __m128i halves = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+  return (uint32_t) _mm_cvtsi128_si32(_mm_add_epi64(halves, _mm_unpackhi_epi64(halves, halves)));
+}
+
+/**
+ * AVX2 kernel, 32 bytes at a time, counting the same way as the SSE4.2 one
+ **/
+__attribute__((target("avx2")))
+inline void countCommandsAvx2(const char* tape, size_t length, CommandCounts& counts) {
+  const __m256i forward = _mm256_set1_epi8('F');
+  const __m256i backward = _mm256_set1_epi8('B');
+  const __m256i left = _mm256_set1_epi8('L');
+  const __m256i right = _mm256_set1_epi8('R');
+  const __m256i zero = _mm256_setzero_si256();
+
+  size_t i = 0;
+  while (i + 32 <= length) {
+    __m256i forwardLanes = zero, backwardLanes = zero, leftLanes = zero;
+    size_t batchEnd = std::min(length - length % 32, i + 255 * 32);
+    for (; i < batchEnd; i += 32) {
+      __m256i bytes = _mm256_loadu_si256((const __m256i*) (tape + i));
+      __m256i isForward = _mm256_cmpeq_epi8(bytes, forward);
+      __m256i isBackward = _mm256_cmpeq_epi8(bytes, backward);
+      __m256i isLeft = _mm256_cmpeq_epi8(bytes, left);
+      __m256i isRight = _mm256_cmpeq_epi8(bytes, right);
+      __m256i isValid = _mm256_or_si256(_mm256_or_si256(isForward, isBackward), _mm256_or_si256(isLeft, isRight));
+      if (_mm256_movemask_epi8(isValid) != -1) {
+        break;
+      }
+      forwardLanes = _mm256_sub_epi8(forwardLanes, isForward);
+      backwardLanes = _mm256_sub_epi8(backwardLanes, isBackward);
+      leftLanes = _mm256_sub_epi8(leftLanes, isLeft);
+    }
+    size_t numForward = sumAbsoluteDifferenceLanes(_mm256_sad_epu8(forwardLanes, zero));
+    size_t numBackward = sumAbsoluteDifferenceLanes(_mm256_sad_epu8(backwardLanes, zero));
+    size_t numLeft = sumAbsoluteDifferenceLanes(_mm256_sad_epu8(leftLanes, zero));
+    counts.numForward += numForward;
+    counts.numBackward += numBackward;
+    counts.numLeft += numLeft;
+    counts.numRight += (i - counts.firstInvalid) - numForward - numBackward - numLeft;
+    counts.firstInvalid = i;
+    if (i < batchEnd) {
+      break;
+    }
+  }
+  if (countCommandsScalar(tape, tape + i, tape + length, counts)) {
+    counts.firstInvalid = length;
+  }
+}
+#endif
+
+/**
+ * Validates and counts the commands in [tape, tape + length) on the given kernel
+ * Falls back to the scalar kernel when the CPU rules the kernel out
+ **/
+inline CommandCounts validateCommands(const char* tape, size_t length, StepKernel kernel) {
+  CommandCounts counts;
+  counts.numForward = 0;
+  counts.numBackward = 0;
+  counts.numLeft = 0;
+  counts.numRight = 0;
+  // Kernels use firstInvalid as the end of the prefix counted so far
+  counts.firstInvalid = 0;
+  if (!isStepKernelSupported(kernel)) {
+    kernel = KERNEL_SCALAR;
+  }
+  switch (kernel) {
+#ifdef ROVER_X86_KERNELS
+    case KERNEL_AVX2: {
+      countCommandsAvx2(tape, length, counts);
+      break;
+    }
+    case KERNEL_SSE42: {
+      countCommandsSse42(tape, length, counts);
+      break;
+    }
+#endif
+    default: {
+      if (countCommandsScalar(tape, tape, tape + length, counts)) {
+        counts.firstInvalid = length;
+      }
+      break;
+    }
+  }
+  return counts;
+}
+
+/**
+ * Validates and counts commands on the fastest kernel the CPU supports
+ **/
+inline CommandCounts validateCommands(CommandText movements) {
+  return validateCommands(movements.data(), movements.size(), bestStepKernel());
+}
+
+/**
+ * PACKED COMMAND TAPES
+ *
+ * Every command is one of four symbols, so a tape can hold four per byte.
+ * Command i sits in bits 2 * (i % 4) of byte i / 4, coded as
+ * 'F' = 0, 'B' = 1, 'L' = 2, 'R' = 3; unused bits of the last byte are 0.
+ **/
+
+/**
+ * Command for each 2-bit code
+ **/
+const char PACKED_COMMANDS[4] = { 'F', 'B', 'L', 'R' };
+
+/**
+ * Commands unpacked at a time when a packed tape is run, a multiple of 4
+ **/
+const size_t PACKED_BLOCK_COMMANDS = 4096;
+
+/**
+ * The command at the given index of a packed tape
+ **/
+inline char packedCommand(const uint8_t* packed, size_t index) {
+  return PACKED_COMMANDS[(packed[index / 4] >> (2 * (index % 4))) & 3];
+}
+
+/**
+ * Scalar kernels, handling commands [begin, end); begin must be a multiple of 4
+ **/
+inline void packCommandsScalar(const char* tape, uint8_t* packed, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i += 4) {
+    uint8_t byte = 0;
+    for (size_t j = i; j < std::min(i + 4, end); j++) {
+      uint8_t code = tape[j] == 'B' ? 1 : tape[j] == 'L' ? 2 : tape[j] == 'R' ? 3 : 0;
+      byte |= (uint8_t) (code << (2 * (j - i)));
+    }
+    packed[i / 4] = byte;
+  }
+}
+
+inline void unpackCommandsScalar(const uint8_t* packed, char* tape, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    tape[i] = packedCommand(packed, i);
+  }
+}
+
+#ifdef ROVER_X86_KERNELS
+/**
+ * SSE4.2 kernels, 16 commands (4 packed bytes) at a time
+ *
+ * Packing turns each byte into its code with compares, then folds four
+ * codes into one byte with two multiply-adds (weights 1, 4 then 1, 16).
+ * Unpacking spreads each packed byte over four lanes, masks out one field
+ * per lane and turns the field back into a character with compares
+ **/
+__attribute__((target("sse4.2")))
+inline void packCommandsSse42(const char* tape, size_t length, uint8_t* packed) {
+  const __m128i backward = _mm_set1_epi8('B');
+  const __m128i left = _mm_set1_epi8('L');
+  const __m128i right = _mm_set1_epi8('R');
+  const __m128i one = _mm_set1_epi8(1);
+  const __m128i two = _mm_set1_epi8(2);
+  const __m128i three = _mm_set1_epi8(3);
+  const __m128i pairWeights = _mm_set1_epi16(0x0401);
+  const __m128i quadWeights = _mm_set1_epi32(0x00100001);
+  const __m128i lowBytes = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i bytes = _mm_loadu_si128((const __m128i*) (tape + i));
+    __m128i codes = _mm_or_si128(_mm_and_si128(_mm_cmpeq_epi8(bytes, backward), one),
+                                 _mm_or_si128(_mm_and_si128(_mm_cmpeq_epi8(bytes, left), two),
+                                              _mm_and_si128(_mm_cmpeq_epi8(bytes, right), three)));
+    __m128i quads = _mm_madd_epi16(_mm_maddubs_epi16(codes, pairWeights), quadWeights);
+    int32_t word = _mm_cvtsi128_si32(_mm_shuffle_epi8(quads, lowBytes));
+    std::memcpy(packed + i / 4, &word, sizeof(word));
+  }
+  packCommandsScalar(tape, packed, i, length);
+}
+
+__attribute__((target("sse4.2")))
+inline void unpackCommandsSse42(const uint8_t* packed, size_t length, char* tape) {
+  const __m128i spread = _mm_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3);
+  const __m128i fields = _mm_setr_epi8(3, 12, 48, (char) 192, 3, 12, 48, (char) 192,
+                                       3, 12, 48, (char) 192, 3, 12, 48, (char) 192);
+  const __m128i backwardFields = _mm_setr_epi8(1, 4, 16, 64, 1, 4, 16, 64, 1, 4, 16, 64, 1, 4, 16, 64);
+  const __m128i leftFields = _mm_setr_epi8(2, 8, 32, (char) 128, 2, 8, 32, (char) 128,
+                                           2, 8, 32, (char) 128, 2, 8, 32, (char) 128);
+  const __m128i forward = _mm_set1_epi8('F');
+  const __m128i toBackward = _mm_set1_epi8('B' - 'F');
+  const __m128i toLeft = _mm_set1_epi8('L' - 'F');
+  const __m128i toRight = _mm_set1_epi8('R' - 'F');
+
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    int32_t word;
+    std::memcpy(&word, packed + i / 4, sizeof(word));
+    __m128i field = _mm_and_si128(_mm_shuffle_epi8(_mm_cvtsi32_si128(word), spread), fields);
+    __m128i chars = _mm_add_epi8(forward, _mm_and_si128(_mm_cmpeq_epi8(field, backwardFields), toBackward));
+    chars = _mm_add_epi8(chars, _mm_and_si128(_mm_cmpeq_epi8(field, leftFields), toLeft));
+    chars = _mm_add_epi8(chars, _mm_and_si128(_mm_cmpeq_epi8(field, fields), toRight));
+    _mm_storeu_si128((__m128i*) (tape + i), chars);
+  }
+  unpackCommandsScalar(packed, tape, i, length);
+}
+
+/**
+ * AVX2 kernels, 32 commands (8 packed bytes) at a time, working the same way
+ **/
+__attribute__((target("avx2")))
+inline void packCommandsAvx2(const char* tape, size_t length, uint8_t* packed) {
+  const __m256i backward = _mm256_set1_epi8('B');
+  const __m256i left = _mm256_set1_epi8('L');
+  const __m256i right = _mm256_set1_epi8('R');
+  const __m256i one = _mm256_set1_epi8(1);
+  const __m256i two = _mm256_set1_epi8(2);
+  const __m256i three = _mm256_set1_epi8(3);
+  const __m256i pairWeights = _mm256_set1_epi16(0x0401);
+  const __m256i quadWeights = _mm256_set1_epi32(0x00100001);
+  const __m256i lowBytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                            0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m256i laneWords = _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1);
+
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    __m256i bytes = _mm256_loadu_si256((const __m256i*) (tape + i));
+    __m256i codes = _mm256_or_si256(_mm256_and_si256(_mm256_cmpeq_epi8(bytes, backward), one),
+                                    _mm256_or_si256(_mm256_and_si256(_mm256_cmpeq_epi8(bytes, left), two),
+                                                    _mm256_and_si256(_mm256_cmpeq_epi8(bytes, right), three)));
+    __m256i quads = _mm256_madd_epi16(_mm256_maddubs_epi16(codes, pairWeights), quadWeights);
+    __m256i gathered = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(quads, lowBytes), laneWords);
+    _mm_storel_epi64((__m128i*) (packed + i / 4), _mm256_castsi256_si128(gathered));
+  }
+  packCommandsScalar(tape, packed, i, length);
+}
+
+__attribute__((target("avx2")))
+inline void unpackCommandsAvx2(const uint8_t* packed, size_t length, char* tape) {
+  const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                          4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7);
+  const __m256i fields = _mm256_set1_epi32((int) 0xC0300C03);
+  const __m256i backwardFields = _mm256_set1_epi32(0x40100401);
+  const __m256i leftFields = _mm256_set1_epi32((int) 0x80200802);
+  const __m256i forward = _mm256_set1_epi8('F');
+  const __m256i toBackward = _mm256_set1_epi8('B' - 'F');
+  const __m256i toLeft = _mm256_set1_epi8('L' - 'F');
+  const __m256i toRight = _mm256_set1_epi8('R' - 'F');
+
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    long long word;
+    std::memcpy(&word, packed + i / 4, sizeof(word));
+    __m256i field = _mm256_and_si256(_mm256_shuffle_epi8(_mm256_set1_epi64x(word), spread), fields);
+    __m256i chars = _mm256_add_epi8(forward, _mm256_and_si256(_mm256_cmpeq_epi8(field, backwardFields), toBackward));
+    chars = _mm256_add_epi8(chars, _mm256_and_si256(_mm256_cmpeq_epi8(field, leftFields), toLeft));
+    chars = _mm256_add_epi8(chars, _mm256_and_si256(_mm256_cmpeq_epi8(field, fields), toRight));
+    _mm256_storeu_si256((__m256i*) (tape + i), chars);
+  }
+  unpackCommandsScalar(packed, tape, i, length);
+}
+#endif
+
+/**
+ * Packs length valid commands into (length + 3) / 4 bytes on the given kernel
+ * Falls back to the scalar kernel when the CPU rules the kernel out
+ **/
+inline void packCommands(const char* tape, size_t length, uint8_t* packed, StepKernel kernel) {
+  if (!isStepKernelSupported(kernel)) {
+    kernel = KERNEL_SCALAR;
+  }
+  switch (kernel) {
+#ifdef ROVER_X86_KERNELS
+    case KERNEL_AVX2: {
+      packCommandsAvx2(tape, length, packed);
+      break;
+    }
+    case KERNEL_SSE42: {
+      packCommandsSse42(tape, length, packed);
+      break;
+    }
+#endif
+    default: {
+      packCommandsScalar(tape, packed, 0, length);
+      break;
+    }
+  }
+}
+
+/**
+ * Unpacks the first length commands of a packed tape into characters
+ **/
+inline void unpackCommands(const uint8_t* packed, size_t length, char* tape, StepKernel kernel) {
+  if (!isStepKernelSupported(kernel)) {
+    kernel = KERNEL_SCALAR;
+  }
+  switch (kernel) {
+#ifdef ROVER_X86_KERNELS
+    case KERNEL_AVX2: {
+      unpackCommandsAvx2(packed, length, tape);
+      break;
+    }
+    case KERNEL_SSE42: {
+      unpackCommandsSse42(packed, length, tape);
+      break;
+    }
+#endif
+    default: {
+      unpackCommandsScalar(packed, tape, 0, length);
+      break;
+    }
+  }
+}
+
+/**
+ * A command tape stored at four commands per byte
+ * Rovers and compiled tapes read it directly, without unpacking it first
+ **/
+class PackedTape {
+public:
+  /**
+   * Packs a command string
+   * Throws when the string holds anything but 'F', 'B', 'L', 'R'
+   **/
+  explicit PackedTape(CommandText movements) {
+    if (validateCommands(movements).firstInvalid < movements.size()) {
+      throw std::runtime_error("Invalid movement");
+    }
+    this->numCommands = movements.size();
+    this->bytes.resize((movements.size() + 3) / 4);
+    packCommands(movements.data(), movements.size(), this->bytes.data(), bestStepKernel());
+  }
+
+  /**
+   * Takes a tape that is already packed, such as one read back from an archive
+   **/
+  PackedTape(std::vector<uint8_t> bytes, size_t numCommands) {
+    if (bytes.size() != (numCommands + 3) / 4) {
+      throw std::runtime_error("Packed tape size does not match its command count");
+    }
+    this->bytes = std::move(bytes);
+    this->numCommands = numCommands;
+  }
+
+  /**
+   * GETTERS
+   **/
+  size_t getNumCommands() const { return this->numCommands; }
+  const std::vector<uint8_t>& getBytes() const { return this->bytes; }
+  char getCommand(size_t index) const { return packedCommand(this->bytes.data(), index); }
+
+  /**
+   * The tape as a command string again
+   **/
+  std::string unpack() const {
+    std::string movements(this->numCommands, 'F');
+    unpackCommands(this->bytes.data(), this->numCommands, &movements[0], bestStepKernel());
+    return movements;
+  }
+
+private:
+  /**
+   * Packed commands, four to a byte
+   **/
+  std::vector<uint8_t> bytes;
+
+  /**
+   * Number of commands on the tape
+   **/
+  size_t numCommands;
+};
+
+/**
+ * Reasons a movement sequence stops
+ **/
+enum MoveStatus {
+  MOVE_COMPLETED = 0,
+  MOVE_BLOCKED = 1,
+  MOVE_INVALID_COMMAND = 2,
+  MOVE_BLOCKED_BY_ROVER = 3
+};
+
+/**
+ * Outcome of a non-throwing movement call
+ *
+ * commandsConsumed counts the commands that were fully executed, so on a
+ * failure it is also the offset of the command that stopped the rover.
+ * blockedRow/blockedCol hold the cell that was in the way when status is
+ * MOVE_BLOCKED or MOVE_BLOCKED_BY_ROVER and are -1 otherwise.
+ **/
+struct MoveResult {
+  MoveStatus status;
+  size_t commandsConsumed;
+  int row, col;
+  Direction dir;
+  int blockedRow, blockedCol;
+};
+
+/**
+ * Kinds of run-length operation a command string compiles to
+ **/
+enum TapeOpKind {
+  TAPE_FORWARD = 0,
+  TAPE_BACKWARD = 1,
+  TAPE_ROTATE = 2,
+  TAPE_INVALID = 3
+};
+
+/**
+ * A run of identical movements, or a run of rotations
+ *
+ * count is the number of commands the op stands for. A rotation op folds a
+ * whole run of 'L'/'R' into the direction each heading ends up facing.
+ **/
+struct TapeOp {
+  TapeOpKind kind;
+  size_t count;
+  Direction rotation[4];
+};
+
+/**
+ * A command string compiled into run-length operations
+ * Compile once, then run it on any number of rovers with Rover::tryMove
+ **/
+class CompiledTape {
+public:
+  /**
+   * Compiles a command string of 'F', 'B', 'L', 'R' characters
+   * Compilation stops at the first invalid character, which becomes a
+   * TAPE_INVALID op so executing the tape fails at the same point move() would
+   **/
+  CompiledTape(CommandText movements) {
+    this->numCommands = 0;
+    for (char movement : movements) {
+      if (!append(movement)) {
+        break;
+      }
+    }
+  }
+
+  /**
+   * Compiles a packed tape straight from its 2-bit codes
+   **/
+  CompiledTape(const PackedTape& tape) {
+    this->numCommands = 0;
+    StepKernel kernel = bestStepKernel();
+    char block[PACKED_BLOCK_COMMANDS];
+    for (size_t first = 0; first < tape.getNumCommands(); first += PACKED_BLOCK_COMMANDS) {
+      size_t count = std::min(PACKED_BLOCK_COMMANDS, tape.getNumCommands() - first);
+      unpackCommands(tape.getBytes().data() + first / 4, count, block, kernel);
+      for (size_t i = 0; i < count; i++) {
+        append(block[i]);
+      }
+    }
+  }
+
+  /**
+   * GETTERS
+   **/
+  const std::vector<TapeOp>& getOps() const { return this->ops; }
+  size_t getNumCommands() const { return this->numCommands; }
+
+  /**
+   * Whether the tape was compiled without hitting an invalid character
+   **/
+  bool isValid() const { return this->ops.empty() || this->ops.back().kind != TAPE_INVALID; }
+
+private:
+  /**
+   * Run-length operations, in execution order
+   **/
+  std::vector<TapeOp> ops;
+
+  /**
+   * Number of valid commands the tape was compiled from
+   **/
+  size_t numCommands;
+
+  /**
+   * Adds one command to the end of the tape
+   * An invalid character becomes a TAPE_INVALID op and returns false
+   **/
+  bool append(char movement) {
+    TapeOpKind kind;
+    if (movement == 'F') {
+      kind = TAPE_FORWARD;
+    } else if (movement == 'B') {
+      kind = TAPE_BACKWARD;
+    } else if (movement == 'L' || movement == 'R') {
+      kind = TAPE_ROTATE;
+    } else {
+      this->ops.push_back(makeOp(TAPE_INVALID));
+      return false;
+    }
+
+    if (this->ops.empty() || this->ops.back().kind != kind) {
+      this->ops.push_back(makeOp(kind));
+    }
+    TapeOp& op = this->ops.back();
+    op.count++;
+    if (kind == TAPE_ROTATE) {
+      for (int dir = NORTH; dir <= WEST; dir++) {
+        op.rotation[dir] = (Direction) COMMAND_TABLE.decode(op.rotation[dir], movement).dir;
+      }
+    }
+    this->numCommands++;
+    return true;
+  }
+
+  /**
+   * Creates an empty op whose rotation leaves every heading unchanged
+   **/
+  static TapeOp makeOp(TapeOpKind kind) {
+    TapeOp op;
+    op.kind = kind;
+    op.count = 0;
+    for (int dir = NORTH; dir <= WEST; dir++) {
+      op.rotation[dir] = (Direction) dir;
+    }
+    return op;
+  }
+};
+
+/**
+ * The effect of a command sequence on a rover's pose when nothing is in the way
+ *
+ * Indexed by the direction the rover starts out facing: how far it travels
+ * along rows and cols, and which way it ends up facing. Transforms compose
+ * with then(), so a long tape can be summarised in pieces and joined back up.
+ **/
+struct PoseTransform {
+  long long rowOffset[4];
+  long long colOffset[4];
+  Direction finalDir[4];
+
+  /**
+   * Transform of the empty command sequence
+   **/
+  static PoseTransform identity() {
+    PoseTransform transform;
+    for (int dir = NORTH; dir <= WEST; dir++) {
+      transform.rowOffset[dir] = 0;
+      transform.colOffset[dir] = 0;
+      transform.finalDir[dir] = (Direction) dir;
+    }
+    return transform;
+  }
+
+  /**
+   * Transform of applying this one followed by next
+   **/
+  PoseTransform then(const PoseTransform& next) const {
+    PoseTransform transform;
+    for (int dir = NORTH; dir <= WEST; dir++) {
+      Direction midDir = this->finalDir[dir];
+      transform.rowOffset[dir] = this->rowOffset[dir] + next.rowOffset[midDir];
+      transform.colOffset[dir] = this->colOffset[dir] + next.colOffset[midDir];
+      transform.finalDir[dir] = next.finalDir[midDir];
+    }
+    return transform;
+  }
+
+  /**
+   * Extends the transform by a single command
+   * Returns false, leaving the transform untouched, for invalid characters
+   **/
+  bool append(char movement) {
+    if (!COMMAND_TABLE.decode(NORTH, movement).isValid) {
+      return false;
+    }
+    for (int dir = NORTH; dir <= WEST; dir++) {
+      const CommandStep& step = COMMAND_TABLE.decode(this->finalDir[dir], movement);
+      this->rowOffset[dir] += step.rowStep;
+      this->colOffset[dir] += step.colStep;
+      this->finalDir[dir] = (Direction) step.dir;
+    }
+    return true;
+  }
+
+  /**
+   * Transform of a compiled tape, up to its first invalid character
+   * Works a run at a time rather than a command at a time
+   **/
+  static PoseTransform of(const CompiledTape& tape) {
+    PoseTransform transform = identity();
+    for (const TapeOp& op : tape.getOps()) {
+      if (op.kind == TAPE_INVALID) {
+        break;
+      }
+      long long distance = op.kind == TAPE_BACKWARD ? -(long long) op.count : (long long) op.count;
+      for (int dir = NORTH; dir <= WEST; dir++) {
+        if (op.kind == TAPE_ROTATE) {
+          transform.finalDir[dir] = op.rotation[transform.finalDir[dir]];
+        } else {
+          transform.rowOffset[dir] += distance * DIRECTION_ROW_STEP[transform.finalDir[dir]];
+          transform.colOffset[dir] += distance * DIRECTION_COL_STEP[transform.finalDir[dir]];
+        }
+      }
+    }
+    return transform;
+  }
+
+  /**
+   * Applies the transform to a pose on the given grid, wrapping around the planet
+   **/
+  template <class GridType>
+  void apply(const GridType& grid, int& row, int& col, Direction& dir) const {
+    row = grid.convertToGridRow(row + (int) (this->rowOffset[dir] % grid.getNumRows()));
+    col = grid.convertToGridCol(col + (int) (this->colOffset[dir] % grid.getNumCols()));
+    dir = this->finalDir[dir];
+  }
+};
+
+/**
+ * A fixed pool of threads that runs index ranges in chunks with work stealing
+ *
+ * Every thread owns a deque of chunks. A parallelFor starts each deque off
+ * with a contiguous share of the range; a thread works through its own deque
+ * from the front, and once it is empty steals chunks from the back of the
+ * others. Uneven tasks therefore keep every thread busy until the range is
+ * done. The thread calling parallelFor acts as worker 0.
+ **/
+class WorkStealingPool {
+public:
+  /**
+   * Starts a pool of numThreads threads, counting the caller's
+   **/
+  WorkStealingPool(unsigned numThreads) {
+    this->generation = 0;
+    this->isStopping = false;
+    numThreads = std::max(1u, numThreads);
+    for (unsigned worker = 0; worker < numThreads; worker++) {
+      this->queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+    }
+    for (unsigned worker = 1; worker < numThreads; worker++) {
+      this->threads.push_back(std::thread([this, worker]() { workerLoop(worker); }));
+    }
+  }
+
+  /**
+   * Stops and joins the pool's threads
+   **/
+  ~WorkStealingPool() {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->isStopping = true;
+    }
+    this->wake.notify_all();
+    for (std::thread& thread : this->threads) {
+      thread.join();
+    }
+  }
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  /**
+   * GETTERS
+   **/
+  unsigned getNumThreads() const { return (unsigned) this->queues.size(); }
+
+  /**
+   * Runs task(i) for every i in [0, count), chunkSize indices per stolen unit
+   * Returns once every index has run. Tasks must not throw
+   **/
+  template <typename Task>
+  void parallelFor(size_t count, size_t chunkSize, const Task& task) {
+    std::function<void(size_t, size_t)> runRange = [&task](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        task(i);
+      }
+    };
+    run(count, std::max<size_t>(1, chunkSize), runRange);
+  }
+
+private:
+  /**
+   * One parallelFor call, shared by every chunk it was split into
+   **/
+  struct Job {
+    const std::function<void(size_t, size_t)>* runRange;
+    std::atomic<size_t> remainingChunks;
+  };
+
+  /**
+   * A range of indices belonging to a job
+   **/
+  struct Chunk {
+    Job* job;
+    size_t begin, end;
+  };
+
+  /**
+   * A worker's own chunks
+   **/
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<Chunk> chunks;
+  };
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues;
+  std::vector<std::thread> threads;
+
+  /**
+   * Guards generation and isStopping; the condition variables wait on it
+   **/
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable finished;
+  size_t generation;
+  bool isStopping;
+
+  /**
+   * Splits a range into chunks, deals them out and helps until all have run
+   **/
+  void run(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& runRange) {
+    size_t numChunks = (count + chunkSize - 1) / chunkSize;
+    if (numChunks == 0) {
+      return;
+    }
+    Job job;
+    job.runRange = &runRange;
+    job.remainingChunks.store(numChunks);
+
+    size_t numWorkers = this->queues.size();
+    for (size_t chunk = 0; chunk < numChunks; chunk++) {
+      Chunk unit = { &job, chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize) };
+      WorkerQueue& queue = *this->queues[chunk * numWorkers / numChunks];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.chunks.push_back(unit);
+    }
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->generation++;
+    }
+    this->wake.notify_all();
+
+    runChunks(0);
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->finished.wait(lock, [&job]() { return job.remainingChunks.load() == 0; });
+  }
+
+  /**
+   * Body of every pool thread other than the caller's
+   **/
+  void workerLoop(unsigned worker) {
+    size_t seenGeneration = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->wake.wait(lock, [&]() { return this->isStopping || this->generation != seenGeneration; });
+        if (this->isStopping) {
+          return;
+        }
+        seenGeneration = this->generation;
+      }
+      runChunks(worker);
+    }
+  }
+
+  /**
+   * Runs chunks, own ones first and then stolen ones, until none are left anywhere
+   **/
+  void runChunks(unsigned worker) {
+    Chunk chunk;
+    while (takeChunk(worker, chunk)) {
+      (*chunk.job->runRange)(chunk.begin, chunk.end);
+      // The job may be gone as soon as its last chunk is counted off
+      if (chunk.job->remainingChunks.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->finished.notify_all();
+      }
+    }
+  }
+
+  /**
+   * Pops the front of the worker's own deque, or steals from the back of another's
+   **/
+  bool takeChunk(unsigned worker, Chunk& chunk) {
+    size_t numWorkers = this->queues.size();
+    for (size_t offset = 0; offset < numWorkers; offset++) {
+      WorkerQueue& queue = *this->queues[(worker + offset) % numWorkers];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.chunks.empty()) {
+        continue;
+      }
+      if (offset == 0) {
+        chunk = queue.chunks.front();
+        queue.chunks.pop_front();
+      } else {
+        chunk = queue.chunks.back();
+        queue.chunks.pop_back();
+      }
+      return true;
+    }
+    return false;
+  }
+};
+
+/**
+ * Outcome of Rover::tryRepeat
+ *
+ * repetitionsCompleted counts the full passes through the program. When the
+ * rover stops early it is also the index of the failing pass, and
+ * move.commandsConsumed is the offset of the failing command within it.
+ **/
+struct RepeatResult {
+  size_t repetitionsCompleted;
+  MoveResult move;
+};
+
+/**
+ * A rover's position and heading packed into one 64-bit word
+ * Bits 0-30 hold the row, bits 31-61 the col and bits 62-63 the direction.
+ * It is trivially copyable, so poses can be kept in plain arrays and
+ * snapshotted with memcpy. Rows and cols must be in [0, 2^31).
+ **/
+class RoverPose {
+public:
+  RoverPose() = default;
+
+  RoverPose(int row, int col, Direction dir)
+      : bits(((uint64_t) (uint32_t) row) | ((uint64_t) (uint32_t) col << COL_SHIFT) | ((uint64_t) dir << DIR_SHIFT)) {}
+
+  /**
+   * GETTERS
+   **/
+  int getRow() const { return (int) (this->bits & COORDINATE_MASK); }
+  int getCol() const { return (int) ((this->bits >> COL_SHIFT) & COORDINATE_MASK); }
+  Direction getDir() const { return (Direction) (this->bits >> DIR_SHIFT); }
+
+  /**
+   * SETTERS
+   **/
+  void setRow(int row) { this->bits = (this->bits & ~COORDINATE_MASK) | (uint32_t) row; }
+  void setCol(int col) { this->bits = (this->bits & ~(COORDINATE_MASK << COL_SHIFT)) | ((uint64_t) (uint32_t) col << COL_SHIFT); }
+  void setDir(Direction dir) { this->bits = (this->bits & ~(3ULL << DIR_SHIFT)) | ((uint64_t) dir << DIR_SHIFT); }
+
+  bool operator==(const RoverPose& other) const { return this->bits == other.bits; }
+  bool operator!=(const RoverPose& other) const { return this->bits != other.bits; }
+
+private:
+  static const int COL_SHIFT = 31;
+  static const int DIR_SHIFT = 62;
+  static const uint64_t COORDINATE_MASK = (1ULL << 31) - 1;
+
+  uint64_t bits;
+};
+
+static_assert(sizeof(RoverPose) == 8, "RoverPose must pack into one word");
+static_assert(std::is_trivially_copyable<RoverPose>::value, "RoverPose must be trivially copyable");
+
+/**
+ * A rover as a plain value: its packed pose and a pointer to its grid
+ *
+ * Trivially copyable, so handles can be kept in plain arrays, snapshotted
+ * with memcpy and built without allocating. The grid is owned elsewhere and
+ * must outlive every handle on it. Handles hold no cell in the grid's rover
+ * occupancy layer, so other rovers never block them and they never block
+ * other rovers; use BasicRover when rovers have to avoid each other.
+ **/
+template <class GridType>
+class BasicRoverHandle {
+public:
+  BasicRoverHandle() = default;
+
+  /**
+   * Constructs a handle for a given (row, col) position and direction on a grid
+   **/
+  BasicRoverHandle(int row, int col, Direction dir, const GridType& grid) {
+    if (!grid.isValidLocation(row, col)) {
+      throw std::runtime_error("Rover cannot be placed here");
+    }
+    if (dir < NORTH || dir > WEST) {
+      throw std::runtime_error("Invalid direction");
+    }
+    this->pose = RoverPose(row, col, dir);
+    this->grid = &grid;
+  }
+
+  /**
+   * Constructs a handle at a saved pose on a grid
+   **/
+  BasicRoverHandle(RoverPose pose, const GridType& grid)
+      : BasicRoverHandle(pose.getRow(), pose.getCol(), pose.getDir(), grid) {}
+
+  /**
+   * GETTERS
+   **/
+  int getRow() const { return this->pose.getRow(); }
+  int getCol() const { return this->pose.getCol(); }
+  int getDir() const { return this->pose.getDir(); }
+  RoverPose getPose() const { return this->pose; }
+  const GridType& getGrid() const { return *this->grid; }
+
+  /**
+   * Non-throwing movement, with the same results as Rover::tryMove
+   * Stops at the first obstacle or invalid character and reports why
+   **/
+  MoveResult tryMove(CommandText movements) noexcept {
+    return tryMove(movements.data(), movements.data() + movements.size());
+  }
+
+  /**
+   * Non-throwing movement over the commands in [begin, end)
+   **/
+  MoveResult tryMove(const char* begin, const char* end) noexcept {
+    MoveResult result;
+    result.status = MOVE_COMPLETED;
+    result.commandsConsumed = 0;
+    result.blockedRow = -1;
+    result.blockedCol = -1;
+    for (const char* movement = begin; movement != end; movement++) {
+      const CommandStep& step = COMMAND_TABLE.decode(this->pose.getDir(), *movement);
+      if (!step.isValid) {
+        result.status = MOVE_INVALID_COMMAND;
+        break;
+      }
+      if (step.rowStep != 0 || step.colStep != 0) {
+        int newRow = this->grid->wrapStepRow(this->pose.getRow() + step.rowStep);
+        int newCol = this->grid->wrapStepCol(this->pose.getCol() + step.colStep);
+        if (!this->grid->isValidLocation(newRow, newCol)) {
+          result.status = MOVE_BLOCKED;
+          result.blockedRow = newRow;
+          result.blockedCol = newCol;
+          break;
+        }
+        this->pose = RoverPose(newRow, newCol, this->pose.getDir());
+      } else {
+        this->pose.setDir((Direction) step.dir);
+      }
+      result.commandsConsumed++;
+    }
+    result.row = this->pose.getRow();
+    result.col = this->pose.getCol();
+    result.dir = this->pose.getDir();
+    return result;
+  }
+
+  /**
+   * Non-throwing movement over a packed tape, unpacked a block at a time
+   **/
+  MoveResult tryMove(const PackedTape& tape) noexcept {
+    StepKernel kernel = bestStepKernel();
+    char block[PACKED_BLOCK_COMMANDS];
+    MoveResult result = makeResult(MOVE_COMPLETED, 0);
+    for (size_t first = 0; first < tape.getNumCommands(); first += PACKED_BLOCK_COMMANDS) {
+      size_t count = std::min(PACKED_BLOCK_COMMANDS, tape.getNumCommands() - first);
+      unpackCommands(tape.getBytes().data() + first / 4, count, block, kernel);
+      size_t consumed = result.commandsConsumed;
+      result = tryMove(block, block + count);
+      result.commandsConsumed += consumed;
+      if (result.status != MOVE_COMPLETED) {
+        break;
+      }
+    }
+    return result;
+  }
+
+private:
+  /**
+   * Current row, col and direction of rover
+   **/
+  RoverPose pose;
+
+  /**
+   * Grid the rover is on, owned by the caller
+   **/
+  const GridType* grid;
+
+  /**
+   * Result of a move that ends at the handle's current pose
+   **/
+  MoveResult makeResult(MoveStatus status, size_t commandsConsumed) const {
+    MoveResult result;
+    result.status = status;
+    result.commandsConsumed = commandsConsumed;
+    result.row = this->pose.getRow();
+    result.col = this->pose.getCol();
+    result.dir = this->pose.getDir();
+    result.blockedRow = -1;
+    result.blockedCol = -1;
+    return result;
+  }
+};
+
+/**
+ * A rover handle on the default, dense grid
+ **/
+typedef BasicRoverHandle<Grid> RoverHandle;
+
+static_assert(std::is_trivially_copyable<RoverHandle>::value, "RoverHandle must be trivially copyable");
+static_assert(sizeof(RoverHandle) == sizeof(RoverPose) + sizeof(const Grid*), "RoverHandle must be a pose and a pointer");
+
+/**
+ * Represents a Rover object
+ * A Rover has a (row, col) position, a direction, and a grid upon which it sits
+ * GridType is any BasicGrid, so the same rover runs on every storage policy
+ *
+ * A rover keeps its grid alive and may hold a cell in the occupancy layer, so
+ * it is not a plain value: copying one updates the grid's reference count and
+ * destroying one gives up its cell. getHandle() gives the trivially copyable
+ * BasicRoverHandle for arrays and memcpy snapshots.
+ **/
+template <class GridType>
+class BasicRover {
+public:
+  /**
+   * Constructs a rover for a given (row, col) position, a direction, and a shared grid
+   *
+   * This is the way to put rovers on a planet. The grid is referenced, not
+   * copied, so any number of rovers can sit on the same planet and all of
+   * them see obstacles placed on it later. A rover that should keep its own
+   * snapshot is given std::make_shared<const GridType>(grid), so the copy
+   * shows at the call site
+   **/
+  BasicRover(int row, int col, Direction dir, std::shared_ptr<const GridType> grid) {
+    init(row, col, dir, std::move(grid));
+  }
+
+  /**
+   * Constructs a rover on a grid built just for it, such as Rover(r, c, d, Grid(n, m))
+   * The grid is moved into a handle of its own, not copied
+   **/
+  BasicRover(int row, int col, Direction dir, GridType&& grid) {
+    init(row, col, dir, std::make_shared<const GridType>(std::move(grid)));
+  }
+
+  /**
+   * Compatibility constructor: puts the rover on a private snapshot of grid
+   *
+   * Copying a dense grid costs O(rows * cols / 64) per rover, and obstacles
+   * placed on the original afterwards are not seen, so it is deprecated in
+   * favour of the shared grid constructor
+   **/
+  ROVER_DEPRECATED("copies the whole grid; pass a std::shared_ptr, or std::make_shared<const GridType>(grid) for a snapshot")
+  BasicRover(int row, int col, Direction dir, const GridType& grid) {
+    init(row, col, dir, std::make_shared<const GridType>(grid));
+  }
+
+  /**
+   * Constructs a rover at a saved pose on a shared grid
+   **/
+  BasicRover(RoverPose pose, std::shared_ptr<const GridType> grid) {
+    init(pose.getRow(), pose.getCol(), pose.getDir(), std::move(grid));
+  }
+
+  /**
+   * Copies a rover
+   * Two rovers cannot share a cell, so a rover holding a cell on a grid with
+   * rover occupancy cannot be copied, only moved
+   **/
+  BasicRover(const BasicRover& other)
+      : pose(other.pose), grid(other.grid), roverId(OccupancyLayer::NO_ROVER) {
+    if (other.roverId != OccupancyLayer::NO_ROVER) {
+      throw std::runtime_error("Rover cannot be copied onto an occupied cell");
+    }
+  }
+
+  /**
+   * Moves a rover, handing over the cell it holds
+   **/
+  BasicRover(BasicRover&& other) noexcept
+      : pose(other.pose), grid(std::move(other.grid)), roverId(other.roverId) {
+    other.roverId = OccupancyLayer::NO_ROVER;
+  }
+
+  BasicRover& operator=(const BasicRover& other) {
+    if (this != &other) {
+      BasicRover copy(other);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+
+  BasicRover& operator=(BasicRover&& other) noexcept {
+    if (this != &other) {
+      leaveCell();
+      this->pose = other.pose;
+      this->grid = std::move(other.grid);
+      this->roverId = other.roverId;
+      other.roverId = OccupancyLayer::NO_ROVER;
+    }
+    return *this;
+  }
+
+  /**
+   * Frees the rover's cell for other rovers
+   **/
+  ~BasicRover() {
+    leaveCell();
+  }
+
+  /**
+   * GETTERS
+   **/
+  int getRow() const { return this->pose.getRow(); }
+  int getCol() const { return this->pose.getCol(); }
+  int getDir() const { return this->pose.getDir(); }
+  RoverPose getPose() const { return this->pose; }
+
+  /**
+   * The rover's pose and grid as a plain value, holding no cell
+   * The handle is only valid while this rover keeps the grid alive
+   **/
+  BasicRoverHandle<GridType> getHandle() const { return BasicRoverHandle<GridType>(this->pose, *this->grid); }
+
+
+  /**
+   * MOVEMENT
+   **/
+
+  /**
+   * Handles movement when input as a string
+   * Characters allowed are 'F', 'B', 'L', 'R'
+   * Throws when an obstacle or an invalid character is encountered
+   * The whole string is validated first, so an invalid character anywhere
+   * in it throws before the rover has moved at all
+   **/
+  void move(CommandText movements) {
+    throwOnInvalid(movements);
+    throwOnFailure(tryMove(movements));
+  }
+
+  /**
+   * Handles movement when input as a single character
+   * Characters allowed are 'F', 'B', 'L', 'R'
+   * Throws when an obstacle or an invalid character is encountered
+   **/
+  void move(char movement) {
+    throwOnFailure(tryMove(movement));
+  }
+
+  /**
+   * Non-throwing version of move(CommandText)
+   * Stops at the first obstacle or invalid character and reports why
+   **/
+  MoveResult tryMove(CommandText movements) noexcept {
+    return tryMove(movements.data(), movements.data() + movements.size());
+  }
+
+  /**
+   * Non-throwing movement over the commands in [begin, end)
+   **/
+  MoveResult tryMove(const char* begin, const char* end) noexcept {
+    MoveResult result = makeResult(MOVE_COMPLETED, 0);
+    for (const char* movement = begin; movement != end; movement++) {
+      if (!moveHelper(*movement, result)) {
+        break;
+      }
+      result.commandsConsumed++;
+    }
+    recordPose(result);
+    return result;
+  }
+
+  /**
+   * Runs the same program the given number of times
+   * Throws when an obstacle or an invalid character is encountered
+   * An invalid program throws before the rover has moved at all
+   **/
+  void repeat(CommandText program, size_t repetitions) {
+    throwOnInvalid(program);
+    throwOnFailure(tryRepeat(program, repetitions).move);
+  }
+
+  /**
+   * Non-throwing version of repeat
+   *
+   * Equivalent to moving through the program concatenated repetitions times,
+   * without doing that work. Obstacles are static, so once the rover's pose
+   * at the start of a pass repeats, every later pass is one already known to
+   * be collision-free. Only the passes up to that point are executed, and the
+   * rest are skipped using the program's net PoseTransform. On an obstacle-free
+   * torus no passes are executed at all. Other rovers count as obstacles; if
+   * one takes the final cell during the call, the skipped passes are stepped
+   * instead and the rover stops at it.
+   **/
+  RepeatResult tryRepeat(CommandText program, size_t repetitions) noexcept {
+    return tryRepeat(CompiledTape(program), repetitions);
+  }
+
+  /**
+   * Runs a packed program the given number of times
+   * Throws when an obstacle is encountered
+   **/
+  void repeat(const PackedTape& program, size_t repetitions) {
+    throwOnFailure(tryRepeat(program, repetitions).move);
+  }
+
+  /**
+   * Non-throwing version of repeat(const PackedTape&, size_t)
+   **/
+  RepeatResult tryRepeat(const PackedTape& program, size_t repetitions) noexcept {
+    return tryRepeat(CompiledTape(program), repetitions);
+  }
+
+  /**
+   * Non-throwing repeat of a program that is already compiled
+   * Behaves exactly like tryRepeat on the string the tape was compiled from
+   **/
+  RepeatResult tryRepeat(const CompiledTape& program, size_t repetitions) noexcept {
+    RepeatResult outcome;
+    outcome.repetitionsCompleted = 0;
+    outcome.move = makeResult(MOVE_COMPLETED, 0);
+    if (repetitions == 0) {
+      return outcome;
+    }
+
+    if (!program.isValid()) {
+      // The first pass already fails on the invalid command
+      outcome.move = tryMove(program);
+      return outcome;
+    }
+
+    PoseTransform transform = PoseTransform::of(program);
+    size_t executed = 0;
+    bool hasEdges = !GridType::Topology::WRAPS_ROWS || !GridType::Topology::WRAPS_COLS;
+    if (this->grid->getNumObstacles() > 0 || this->roverId != OccupancyLayer::NO_ROVER || hasEdges) {
+      executed = std::min(repetitions, repeatPeriodBound(transform));
+    }
+    for (size_t pass = 0; pass < executed; pass++) {
+      MoveResult result = tryMove(program);
+      if (result.status != MOVE_COMPLETED) {
+        outcome.repetitionsCompleted = pass;
+        outcome.move = result;
+        return outcome;
+      }
+    }
+
+    RoverPose skipStart = this->pose;
+    skipRepetitions(transform, repetitions - executed);
+    if (this->roverId != OccupancyLayer::NO_ROVER && (this->getRow() != skipStart.getRow() || this->getCol() != skipStart.getCol())) {
+      // The executed passes already went through the final cell, but a rover
+      // on another thread may have taken it since. If so, step the remaining
+      // passes from where the skip began, so the rover stops at that rover
+      if (this->grid->getOccupancy()->tryOccupy(this->getRow(), this->getCol(), this->roverId)) {
+        this->grid->getOccupancy()->release(skipStart.getRow(), skipStart.getCol(), this->roverId);
+      } else {
+        this->pose = skipStart;
+        for (size_t pass = executed; pass < repetitions; pass++) {
+          MoveResult result = tryMove(program);
+          if (result.status != MOVE_COMPLETED) {
+            outcome.repetitionsCompleted = pass;
+            outcome.move = result;
+            return outcome;
+          }
+        }
+      }
+    }
+    outcome.repetitionsCompleted = repetitions;
+    outcome.move = makeResult(MOVE_COMPLETED, program.getNumCommands());
+    return outcome;
+  }
+
+  /**
+   * Same result as tryMove(CommandText), computed on up to numThreads threads
+   *
+   * Intended for very long tapes. The tape is split into chunks whose
+   * obstacle-free pose transforms are computed in parallel and prefix-combined,
+   * giving the rover's pose at the start of every chunk. A second parallel
+   * pass replays each chunk from that pose to find the earliest collision.
+   * Rovers that avoid other rovers run serially, as the other rovers' cells
+   * are not part of the obstacle map the chunks are checked against.
+   **/
+  MoveResult tryMoveParallel(CommandText movements, unsigned numThreads) {
+    TextCommands commands = { movements.data() };
+    return moveParallel(commands, movements.size(), numThreads);
+  }
+
+  /**
+   * Same result as tryMove(const PackedTape&), computed on up to numThreads threads
+   * Each chunk unpacks its own part of the tape a block at a time
+   **/
+  MoveResult tryMoveParallel(const PackedTape& tape, unsigned numThreads) {
+    PackedCommands commands = { tape.getBytes().data(), bestStepKernel() };
+    return moveParallel(commands, tape.getNumCommands(), numThreads);
+  }
+
+  /**
+   * Non-throwing version of move(char)
+   **/
+  MoveResult tryMove(char movement) noexcept {
+    MoveResult result = makeResult(MOVE_COMPLETED, 0);
+    if (moveHelper(movement, result)) {
+      result.commandsConsumed++;
+    }
+    recordPose(result);
+    return result;
+  }
+
+  /**
+   * Handles movement when input as a compiled tape
+   * Behaves exactly like moving through the original string one command at a time
+   **/
+  void move(const CompiledTape& tape) {
+    throwOnFailure(tryMove(tape));
+  }
+
+  /**
+   * Non-throwing version of move(const CompiledTape&)
+   * Each run of 'F' or 'B' is finished in one bitset scan for the next obstacle
+   **/
+  MoveResult tryMove(const CompiledTape& tape) noexcept {
+    MoveResult result = makeResult(MOVE_COMPLETED, 0);
+    for (const TapeOp& op : tape.getOps()) {
+      if (op.kind == TAPE_ROTATE) {
+        this->setDir(op.rotation[this->getDir()]);
+        result.commandsConsumed += op.count;
+      } else if (op.kind == TAPE_INVALID) {
+        result.status = MOVE_INVALID_COMMAND;
+        break;
+      } else {
+        result.commandsConsumed += moveRoverRun(op.kind == TAPE_FORWARD, op.count, result);
+        if (result.status != MOVE_COMPLETED) {
+          break;
+        }
+      }
+    }
+    recordPose(result);
+    return result;
+  }
+
+  /**
+   * Handles movement when input as a packed tape
+   * Throws when an obstacle is encountered
+   **/
+  void move(const PackedTape& tape) {
+    throwOnFailure(tryMove(tape));
+  }
+
+  /**
+   * Non-throwing version of move(const PackedTape&)
+   **/
+  MoveResult tryMove(const PackedTape& tape) noexcept {
+    return tryMovePacked(tape.getBytes().data(), tape.getNumCommands());
+  }
+
+  /**
+   * Non-throwing movement over numCommands commands packed four to a byte
+   * The commands are unpacked a block at a time into a small buffer on the
+   * stack, so the tape itself can live anywhere, such as a mapped archive
+   **/
+  MoveResult tryMovePacked(const uint8_t* packed, size_t numCommands) noexcept {
+    PackedCommands commands = { packed, bestStepKernel() };
+    return moveCommands(commands, 0, numCommands);
+  }
+
+
+private:
+  /**
+   * Tapes shorter than this are not worth splitting across threads
+   **/
+  static const size_t PARALLEL_MIN_CHUNK = 1 << 16;
+
+  /**
+   * Commands read straight out of a borrowed string
+   **/
+  struct TextCommands {
+    const char* characters;
+
+    const char* read(size_t first, size_t, char*) const {
+      return this->characters + first;
+    }
+  };
+
+  /**
+   * Commands unpacked from a packed tape into the caller's block buffer
+   * first must be a multiple of 4
+   **/
+  struct PackedCommands {
+    const uint8_t* packed;
+    StepKernel kernel;
+
+    const char* read(size_t first, size_t count, char* block) const {
+      unpackCommands(this->packed + first / 4, count, block, this->kernel);
+      return block;
+    }
+  };
+
+  /**
+   * Current row, col and direction of rover
+   **/
+  RoverPose pose;
+
+  /**
+   * Grid that rover is currently on, shared with any other rovers on the planet
+   **/
+  std::shared_ptr<const GridType> grid;
+
+  /**
+   * Id the rover holds its cell under in the grid's occupancy layer,
+   * NO_ROVER when it holds no cell
+   **/
+  uint32_t roverId;
+
+  /**
+   * Gives up the rover's cell in the occupancy layer, if it holds one
+   **/
+  void leaveCell() noexcept {
+    if (this->roverId != OccupancyLayer::NO_ROVER) {
+      this->grid->getOccupancy()->release(this->getRow(), this->getCol(), this->roverId);
+      this->roverId = OccupancyLayer::NO_ROVER;
+    }
+  }
+
+  /**
+   * Moves the rover's claim in the occupancy layer to a new cell
+   * Returns false, leaving the claim where it was, if another rover holds that cell
+   **/
+  bool claimCell(int newRow, int newCol) noexcept {
+    if (this->roverId == OccupancyLayer::NO_ROVER || (newRow == this->getRow() && newCol == this->getCol())) {
+      return true;
+    }
+    OccupancyLayer* occupancy = this->grid->getOccupancy();
+    if (!occupancy->tryOccupy(newRow, newCol, this->roverId)) {
+      return false;
+    }
+    occupancy->release(this->getRow(), this->getCol(), this->roverId);
+    return true;
+  }
+
+  /**
+   * Validates the starting position and sets up the rover's state
+   **/
+  void init(int row, int col, Direction dir, std::shared_ptr<const GridType> grid) {
+    // Validate that the given row and col is valid for the grid
+    // This checks both that the row/col is in the grid,
+    // and that there are no obstacles at this location
+    if (!grid || !grid->isValidLocation(row, col)) {
+      throw std::runtime_error("Rover cannot be placed here");
+    }
+    if (dir < NORTH || dir > WEST) {
+      throw std::runtime_error("Invalid direction");
+    }
+
+    // Claim the cell if rovers on this grid avoid each other
+    this->roverId = OccupancyLayer::NO_ROVER;
+    OccupancyLayer* occupancy = grid->getOccupancy();
+    if (occupancy) {
+      uint32_t id = occupancy->newRoverId();
+      if (!occupancy->tryOccupy(row, col, id)) {
+        throw std::runtime_error("Rover cannot be placed here");
+      }
+      this->roverId = id;
+    }
+
+    // Set vars
+    this->grid = std::move(grid);
+    this->pose = RoverPose(row, col, dir);
+  }
+
+  /**
+   * Builds a result for the rover's current pose
+   **/
+  MoveResult makeResult(MoveStatus status, size_t commandsConsumed) const {
+    MoveResult result;
+    result.status = status;
+    result.commandsConsumed = commandsConsumed;
+    result.row = this->getRow();
+    result.col = this->getCol();
+    result.dir = this->pose.getDir();
+    result.blockedRow = -1;
+    result.blockedCol = -1;
+    return result;
+  }
+
+  /**
+   * Copies the rover's current pose into a result
+   **/
+  void recordPose(MoveResult& result) const {
+    result.row = this->getRow();
+    result.col = this->getCol();
+    result.dir = this->pose.getDir();
+  }
+
+  /**
+   * Runs the commands in [first, end) of a command source, a block at a time
+   **/
+  template <class Commands>
+  MoveResult moveCommands(const Commands& commands, size_t first, size_t end) noexcept {
+    MoveResult result = makeResult(MOVE_COMPLETED, 0);
+    char block[PACKED_BLOCK_COMMANDS];
+    bool isStopped = false;
+    for (; first < end && !isStopped; first += PACKED_BLOCK_COMMANDS) {
+      size_t count = std::min(PACKED_BLOCK_COMMANDS, end - first);
+      const char* movements = commands.read(first, count, block);
+      for (size_t i = 0; i < count; i++) {
+        if (!moveHelper(movements[i], result)) {
+          isStopped = true;
+          break;
+        }
+        result.commandsConsumed++;
+      }
+    }
+    recordPose(result);
+    return result;
+  }
+
+  /**
+   * Runs length commands of a command source on up to numThreads threads
+   * See tryMoveParallel(CommandText, unsigned)
+   **/
+  template <class Commands>
+  MoveResult moveParallel(const Commands& commands, size_t length, unsigned numThreads) {
+    size_t numChunks = std::min<size_t>(numThreads, length / PARALLEL_MIN_CHUNK);
+    if (numChunks <= 1 || this->roverId != OccupancyLayer::NO_ROVER) {
+      return moveCommands(commands, 0, length);
+    }
+    // Chunks start on a whole byte of a packed tape
+    size_t chunkSize = ((length + numChunks - 1) / numChunks + 3) / 4 * 4;
+
+    // Pass 1: summarise every chunk, noting where its valid prefix ends
+    std::vector<PoseTransform> transforms(numChunks, PoseTransform::identity());
+    std::vector<size_t> validLengths(numChunks, 0);
+    runInParallel(numChunks, [&](size_t chunk) {
+      size_t begin = std::min(length, chunk * chunkSize);
+      size_t end = std::min(length, begin + chunkSize);
+      char block[PACKED_BLOCK_COMMANDS];
+      for (size_t first = begin; first < end; first += PACKED_BLOCK_COMMANDS) {
+        size_t count = std::min(PACKED_BLOCK_COMMANDS, end - first);
+        const char* movements = commands.read(first, count, block);
+        size_t valid = 0;
+        while (valid < count && transforms[chunk].append(movements[valid])) {
+          valid++;
+        }
+        validLengths[chunk] += valid;
+        if (valid < count) {
+          break;
+        }
+      }
+    });
+
+    // Exclusive prefix: the pose each chunk starts from, up to the first invalid command
+    std::vector<BasicRover> chunkRovers;
+    BasicRover current = *this;
+    size_t usedChunks = 0;
+    bool isInvalid = false;
+    while (usedChunks < numChunks && usedChunks * chunkSize < length) {
+      chunkRovers.push_back(current);
+      int row = current.getRow();
+      int col = current.getCol();
+      Direction dir = current.pose.getDir();
+      transforms[usedChunks].apply(*this->grid, row, col, dir);
+      usedChunks++;
+      if (!this->grid->isInGrid(row, col)) {
+        // The chunk runs off an edge, so it blocks and later chunks never start
+        break;
+      }
+      current.pose = RoverPose(row, col, dir);
+      if (validLengths[usedChunks - 1] < std::min(chunkSize, length - (usedChunks - 1) * chunkSize)) {
+        isInvalid = true;
+        break;
+      }
+    }
+
+    // Pass 2: replay each chunk against the obstacles, giving up on chunks
+    // that start after a collision another thread already found
+    std::vector<MoveResult> chunkResults(usedChunks);
+    std::atomic<size_t> firstBlockedChunk(usedChunks);
+    runInParallel(usedChunks, [&](size_t chunk) {
+      size_t first = chunk * chunkSize;
+      size_t end = first + validLengths[chunk];
+      MoveResult result = chunkRovers[chunk].makeResult(MOVE_COMPLETED, 0);
+      char block[PACKED_BLOCK_COMMANDS];
+      while (first != end && chunk < firstBlockedChunk.load(std::memory_order_relaxed)) {
+        size_t count = std::min(PACKED_BLOCK_COMMANDS, end - first);
+        const char* movements = commands.read(first, count, block);
+        MoveResult blockResult = chunkRovers[chunk].tryMove(movements, movements + count);
+        blockResult.commandsConsumed += result.commandsConsumed;
+        result = blockResult;
+        if (result.status == MOVE_BLOCKED) {
+          size_t earliest = firstBlockedChunk.load();
+          while (chunk < earliest && !firstBlockedChunk.compare_exchange_weak(earliest, chunk)) {
+          }
+          break;
+        }
+        first += count;
+      }
+      chunkResults[chunk] = result;
+    });
+
+    size_t blockedChunk = firstBlockedChunk.load();
+    if (blockedChunk < usedChunks) {
+      MoveResult result = chunkResults[blockedChunk];
+      result.commandsConsumed += blockedChunk * chunkSize;
+      *this = chunkRovers[blockedChunk];
+      return result;
+    }
+
+    // No collisions: the prefix already holds the final pose
+    *this = current;
+    MoveResult result = makeResult(isInvalid ? MOVE_INVALID_COMMAND : MOVE_COMPLETED, 0);
+    result.commandsConsumed = (usedChunks - 1) * chunkSize + validLengths[usedChunks - 1];
+    return result;
+  }
+
+  /**
+   * Throws the invalid movement error if any character of the string is not a command
+   **/
+  static void throwOnInvalid(CommandText movements) {
+    if (validateCommands(movements).firstInvalid < movements.size()) {
+      throw std::runtime_error("Invalid movement");
+    }
+  }
+
+  /**
+   * Rebuilds the exception the throwing movement API has always raised
+   **/
+  static void throwOnFailure(const MoveResult& result) {
+    switch (result.status) {
+      case MOVE_BLOCKED: {
+        std::string errorMessage = "Obstacle encountered at: " + std::to_string(result.blockedRow) + ", " + std::to_string(result.blockedCol);
+        throw std::runtime_error(errorMessage);
+      }
+      case MOVE_BLOCKED_BY_ROVER: {
+        std::string errorMessage = "Rover encountered at: " + std::to_string(result.blockedRow) + ", " + std::to_string(result.blockedCol);
+        throw std::runtime_error(errorMessage);
+      }
+      case MOVE_INVALID_COMMAND: {
+        throw std::runtime_error("Invalid movement");
+      }
+      default: {
+        break;
+      }
+    }
+  }
+
+  /**
+   * Decodes one command and carries it out
+   * Returns false, recording why in result, if the move could not be made
+   **/
+  bool moveHelper(char movement, MoveResult& result) noexcept {
+    const CommandStep& step = COMMAND_TABLE.decode(this->getDir(), movement);
+    if (!step.isValid) {
+      result.status = MOVE_INVALID_COMMAND;
+      return false;
+    }
+    if (step.rowStep != 0 || step.colStep != 0) {
+      return moveRover(step.rowStep, step.colStep, result);
+    }
+    this->setDir((Direction) step.dir);
+    return true;
+  }
+
+  /**
+   * Moves the rover one cell by the given row and col step
+   * Returns false, recording the blocking cell in result, if an obstacle is in the way
+   **/
+  bool moveRover(int rowStep, int colStep, MoveResult& result) noexcept {
+    int newRow = this->grid->wrapStepRow(this->getRow() + rowStep);
+    int newCol = this->grid->wrapStepCol(this->getCol() + colStep);
+
+    // Verifies that the new row and column have no obstacles placed
+    if (this->grid->isValidLocation(newRow, newCol)) {
+      if (!claimCell(newRow, newCol)) {
+        result.status = MOVE_BLOCKED_BY_ROVER;
+        result.blockedRow = newRow;
+        result.blockedCol = newCol;
+        return false;
+      }
+      this->pose = RoverPose(newRow, newCol, this->pose.getDir());
+      return true;
+    } else {
+      result.status = MOVE_BLOCKED;
+      result.blockedRow = newRow;
+      result.blockedCol = newCol;
+      return false;
+    }
+  }
+
+  /**
+   * Number of passes of a program with the given transform before the
+   * heading at the start of a pass starts cycling, or 0 if the current heading
+   * is already on its cycle. Writes the cycle length to period
+   **/
+  int headingCycle(const PoseTransform& transform, Direction start, int& period) const {
+    Direction headings[5];
+    headings[0] = start;
+    for (int pass = 1; pass <= 4; pass++) {
+      headings[pass] = transform.finalDir[headings[pass - 1]];
+      for (int earlier = 0; earlier < pass; earlier++) {
+        if (headings[earlier] == headings[pass]) {
+          period = pass - earlier;
+          return earlier;
+        }
+      }
+    }
+    // Four headings cannot go five passes without repeating
+    period = 4;
+    return 0;
+  }
+
+  /**
+   * An upper bound on the number of passes of a program before the rover's
+   * starting pose repeats, or it is certain to have run off an edge
+   **/
+  size_t repeatPeriodBound(const PoseTransform& transform) const {
+    int period;
+    int lead = headingCycle(transform, this->pose.getDir(), period);
+
+    // Once on its heading cycle, every period passes shift the rover by the same amount
+    Direction heading = this->pose.getDir();
+    for (int pass = 0; pass < lead; pass++) {
+      heading = transform.finalDir[heading];
+    }
+    long long rowShift = 0;
+    long long colShift = 0;
+    for (int pass = 0; pass < period; pass++) {
+      rowShift += transform.rowOffset[heading];
+      colShift += transform.colOffset[heading];
+      heading = transform.finalDir[heading];
+    }
+
+    long long rowOrder = shiftOrder(rowShift, this->grid->getNumRows(), GridType::Topology::WRAPS_ROWS);
+    long long colOrder = shiftOrder(colShift, this->grid->getNumCols(), GridType::Topology::WRAPS_COLS);
+    long long order = rowOrder / greatestCommonDivisor(rowOrder, colOrder) * colOrder;
+    if ((size_t) order > (SIZE_MAX - lead) / period) {
+      return SIZE_MAX;
+    }
+    return lead + (size_t) period * (size_t) order;
+  }
+
+  /**
+   * How many times a shift can be applied along an axis of the given length
+   * before the rover is back where it started (wrapping axes) or has
+   * certainly gone past an edge (bounded axes, unless the shift is zero)
+   **/
+  static long long shiftOrder(long long shift, long long length, bool wraps) {
+    if (wraps) {
+      return length / greatestCommonDivisor(shift % length, length);
+    }
+    return shift == 0 ? 1 : length / (shift < 0 ? -shift : shift) + 1;
+  }
+
+  /**
+   * Moves the rover as if a program with the given transform ran count times
+   * without meeting any obstacles
+   **/
+  void skipRepetitions(const PoseTransform& transform, size_t count) {
+    int period;
+    int lead = headingCycle(transform, this->pose.getDir(), period);
+    for (; lead > 0 && count > 0; lead--, count--) {
+      applyTransform(transform);
+    }
+    if (count == 0) {
+      return;
+    }
+
+    // The heading now returns to itself every period passes, so whole cycles
+    // are a pure translation that can be multiplied out
+    PoseTransform cycle = PoseTransform::identity();
+    for (int pass = 0; pass < period; pass++) {
+      cycle = cycle.then(transform);
+    }
+    size_t numCycles = count / period;
+    int numRows = this->grid->getNumRows();
+    int numCols = this->grid->getNumCols();
+    long long rowShift = multiplyModulo(numCycles, cycle.rowOffset[this->getDir()], numRows);
+    long long colShift = multiplyModulo(numCycles, cycle.colOffset[this->getDir()], numCols);
+    this->setRow(this->grid->convertToGridRow(this->getRow() + (int) rowShift));
+    this->setCol(this->grid->convertToGridCol(this->getCol() + (int) colShift));
+
+    for (size_t pass = 0; pass < count % period; pass++) {
+      applyTransform(transform);
+    }
+  }
+
+  /**
+   * Moves the rover by a transform, ignoring obstacles
+   **/
+  void applyTransform(const PoseTransform& transform) {
+    int newRow = this->getRow();
+    int newCol = this->getCol();
+    Direction newDir = this->pose.getDir();
+    transform.apply(*this->grid, newRow, newCol, newDir);
+    this->pose = RoverPose(newRow, newCol, newDir);
+  }
+
+  /**
+   * (count * offset) mod modulus, without overflowing
+   **/
+  static long long multiplyModulo(size_t count, long long offset, long long modulus) {
+    long long reducedOffset = (offset % modulus + modulus) % modulus;
+    return (long long) ((count % modulus) * (unsigned long long) reducedOffset % modulus);
+  }
+
+  /**
+   * Greatest common divisor, treating the sign of either argument as irrelevant
+   **/
+  static long long greatestCommonDivisor(long long a, long long b) {
+    a = a < 0 ? -a : a;
+    b = b < 0 ? -b : b;
+    while (b != 0) {
+      long long remainder = a % b;
+      a = b;
+      b = remainder;
+    }
+    return a;
+  }
+
+  /**
+   * Moves the rover forwards/backwards up to count times in a single step
+   * Returns how many moves were made, recording the blocking cell in result
+   * if an obstacle cut the run short
+   **/
+  size_t moveRoverRun(bool isMoveForward, size_t count, MoveResult& result) noexcept {
+    const CommandStep& step = COMMAND_TABLE.decode(this->getDir(), isMoveForward ? 'F' : 'B');
+    int rowStep = step.rowStep;
+    int colStep = step.colStep;
+    if (this->roverId != OccupancyLayer::NO_ROVER) {
+      // Other rovers are not in the obstacle bitset, so claim cell by cell
+      size_t moved = 0;
+      while (moved < count && moveRover(rowStep, colStep, result)) {
+        moved++;
+      }
+      return moved;
+    }
+
+    // Scan the rover's row or column for the nearest obstacle ahead
+    size_t freeCells;
+    if (rowStep != 0) {
+      freeCells = this->grid->freeRunInCol(this->getRow(), this->getCol(), rowStep > 0, count);
+    } else {
+      freeCells = this->grid->freeRunInRow(this->getRow(), this->getCol(), colStep > 0, count);
+    }
+    size_t moved = std::min(freeCells, count);
+
+    int rowOffset = rowStep * (int) (moved % this->grid->getNumRows());
+    int colOffset = colStep * (int) (moved % this->grid->getNumCols());
+    this->setRow(this->grid->convertToGridRow(this->getRow() + rowOffset));
+    this->setCol(this->grid->convertToGridCol(this->getCol() + colOffset));
+
+    if (moved < count) {
+      result.status = MOVE_BLOCKED;
+      result.blockedRow = this->grid->wrapStepRow(this->getRow() + rowStep);
+      result.blockedCol = this->grid->wrapStepCol(this->getCol() + colStep);
+    }
+    return moved;
+  }
+
+  /**
+   * SETTERS
+   **/
+  void setRow(int row) { this->pose.setRow(row); }
+  void setCol(int col) { this->pose.setCol(col); }
+  void setDir(Direction dir) { this->pose.setDir(dir); }
+
+};
+
+template <class GridType>
+const size_t BasicRover<GridType>::PARALLEL_MIN_CHUNK;
+
+/**
+ * A rover on the default, dense grid
+ **/
+typedef BasicRover<Grid> Rover;
+
+/**
+ * A rover on a tiled grid
+ **/
+typedef BasicRover<TiledGrid> TiledRover;
+
+/**
+ * A rover on a sparse grid
+ **/
+typedef BasicRover<SparseGrid> SparseRover;
+
+/**
+ * A rover on a mapped grid file
+ **/
+typedef BasicRover<MappedGrid> MappedRover;
+
+/**
+ * LOCKSTEP STEPPING KERNELS
+ *
+ * Move many rovers one cell forwards (sign 1) or backwards (sign -1) at once.
+ * State is the Fleet's packed arrays; obstacles are read straight from the
+ * grid's 64-bit bitset words. Only the AVX2 kernel views them as 32-bit
+ * halves, since x86 gathers work on 32-bit lanes and x86 is little-endian.
+ * Every kernel produces exactly the same result as the scalar one.
+ **/
+
+/**
+ * Everything a lockstep kernel needs to know about the grid
+ **/
+struct LockstepGrid {
+  const uint64_t* obstacleWords;
+  int wordsPerRow;
+  int numRows, numCols;
+};
+
+/**
+ * Scalar kernel, handling rovers [begin, end)
+ **/
+inline void stepLockstepScalar(const LockstepGrid& grid, int sign, int* rows, int* cols,
+                               const uint8_t* dirs, MoveStatus* statuses, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    int newRow = rows[i] + sign * DIRECTION_ROW_STEP[dirs[i]];
+    int newCol = cols[i] + sign * DIRECTION_COL_STEP[dirs[i]];
+    newRow += newRow < 0 ? grid.numRows : 0;
+    newRow -= newRow >= grid.numRows ? grid.numRows : 0;
+    newCol += newCol < 0 ? grid.numCols : 0;
+    newCol -= newCol >= grid.numCols ? grid.numCols : 0;
+
+    uint64_t word = grid.obstacleWords[(size_t) newRow * grid.wordsPerRow + (newCol >> 6)];
+    bool isFree = ((word >> (newCol & 63)) & 1) == 0;
+    rows[i] = isFree ? newRow : rows[i];
+    cols[i] = isFree ? newCol : cols[i];
+    statuses[i] = isFree ? MOVE_COMPLETED : MOVE_BLOCKED;
+  }
+}
+
+#ifdef ROVER_X86_KERNELS
+/**
+ * 32-bit view of the 64-bit obstacle words, allowed to alias them
+ **/
+typedef int32_t __attribute__((may_alias)) AliasedInt32;
+
+static_assert(sizeof(MoveStatus) == sizeof(int32_t), "SIMD kernels store MoveStatus as 32-bit lanes");
+
+/**
+ * SSE4.2 kernel, 4 rovers at a time
+ * SSE has no gather, so obstacle bits are tested lane by lane
+ **/
+__attribute__((target("sse4.2")))
+inline void stepLockstepSse42(const LockstepGrid& grid, int sign, int* rows, int* cols,
+                              const uint8_t* dirs, MoveStatus* statuses, size_t count) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi32(1);
+  const __m128i two = _mm_set1_epi32(2);
+  const __m128i three = _mm_set1_epi32(3);
+  const __m128i signs = _mm_set1_epi32(sign);
+  const __m128i numRows = _mm_set1_epi32(grid.numRows);
+  const __m128i numCols = _mm_set1_epi32(grid.numCols);
+  const __m128i blocked = _mm_set1_epi32(MOVE_BLOCKED);
+  const __m128i completed = _mm_set1_epi32(MOVE_COMPLETED);
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    int32_t packedDirs;
+    std::memcpy(&packedDirs, dirs + i, sizeof(packedDirs));
+    __m128i dir = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packedDirs));
+
+    // Direction deltas: a true compare is -1, so NORTH/SOUTH give +1/-1 rows
+    __m128i rowStep = _mm_sub_epi32(_mm_cmpeq_epi32(dir, two), _mm_cmpeq_epi32(dir, zero));
+    __m128i colStep = _mm_sub_epi32(_mm_cmpeq_epi32(dir, three), _mm_cmpeq_epi32(dir, one));
+    rowStep = _mm_sign_epi32(rowStep, signs);
+    colStep = _mm_sign_epi32(colStep, signs);
+
+    __m128i row = _mm_loadu_si128((const __m128i*) (rows + i));
+    __m128i col = _mm_loadu_si128((const __m128i*) (cols + i));
+    __m128i newRow = _mm_add_epi32(row, rowStep);
+    __m128i newCol = _mm_add_epi32(col, colStep);
+    newRow = _mm_add_epi32(newRow, _mm_and_si128(_mm_cmpgt_epi32(zero, newRow), numRows));
+    newRow = _mm_sub_epi32(newRow, _mm_andnot_si128(_mm_cmpgt_epi32(numRows, newRow), numRows));
+    newCol = _mm_add_epi32(newCol, _mm_and_si128(_mm_cmpgt_epi32(zero, newCol), numCols));
+    newCol = _mm_sub_epi32(newCol, _mm_andnot_si128(_mm_cmpgt_epi32(numCols, newCol), numCols));
+
+    int32_t laneRows[4], laneCols[4], laneFree[4];
+    _mm_storeu_si128((__m128i*) laneRows, newRow);
+    _mm_storeu_si128((__m128i*) laneCols, newCol);
+    for (int lane = 0; lane < 4; lane++) {
+      uint64_t word = grid.obstacleWords[(size_t) laneRows[lane] * grid.wordsPerRow + (laneCols[lane] >> 6)];
+      laneFree[lane] = ((word >> (laneCols[lane] & 63)) & 1) ? 0 : -1;
+    }
+    __m128i isFree = _mm_loadu_si128((const __m128i*) laneFree);
+
+    _mm_storeu_si128((__m128i*) (rows + i), _mm_blendv_epi8(row, newRow, isFree));
+    _mm_storeu_si128((__m128i*) (cols + i), _mm_blendv_epi8(col, newCol, isFree));
+    _mm_storeu_si128((__m128i*) (statuses + i), _mm_blendv_epi8(blocked, completed, isFree));
+  }
+  stepLockstepScalar(grid, sign, rows, cols, dirs, statuses, i, count);
+}
+
+/**
+ * AVX2 kernel, 8 rovers at a time with gathered obstacle tests
+ **/
+__attribute__((target("avx2")))
+inline void stepLockstepAvx2(const LockstepGrid& grid, int sign, int* rows, int* cols,
+                             const uint8_t* dirs, MoveStatus* statuses, size_t count) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i two = _mm256_set1_epi32(2);
+  const __m256i three = _mm256_set1_epi32(3);
+  const __m256i bitIndexMask = _mm256_set1_epi32(31);
+  const __m256i signs = _mm256_set1_epi32(sign);
+  const __m256i numRows = _mm256_set1_epi32(grid.numRows);
+  const __m256i numCols = _mm256_set1_epi32(grid.numCols);
+  const __m256i halfWordsPerRow = _mm256_set1_epi32(2 * grid.wordsPerRow);
+  const __m256i blocked = _mm256_set1_epi32(MOVE_BLOCKED);
+  const __m256i completed = _mm256_set1_epi32(MOVE_COMPLETED);
+
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i dir = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (dirs + i)));
+
+    // Direction deltas: a true compare is -1, so NORTH/SOUTH give +1/-1 rows
+    __m256i rowStep = _mm256_sub_epi32(_mm256_cmpeq_epi32(dir, two), _mm256_cmpeq_epi32(dir, zero));
+    __m256i colStep = _mm256_sub_epi32(_mm256_cmpeq_epi32(dir, three), _mm256_cmpeq_epi32(dir, one));
+    rowStep = _mm256_sign_epi32(rowStep, signs);
+    colStep = _mm256_sign_epi32(colStep, signs);
+
+    __m256i row = _mm256_loadu_si256((const __m256i*) (rows + i));
+    __m256i col = _mm256_loadu_si256((const __m256i*) (cols + i));
+    __m256i newRow = _mm256_add_epi32(row, rowStep);
+    __m256i newCol = _mm256_add_epi32(col, colStep);
+    newRow = _mm256_add_epi32(newRow, _mm256_and_si256(_mm256_cmpgt_epi32(zero, newRow), numRows));
+    newRow = _mm256_sub_epi32(newRow, _mm256_andnot_si256(_mm256_cmpgt_epi32(numRows, newRow), numRows));
+    newCol = _mm256_add_epi32(newCol, _mm256_and_si256(_mm256_cmpgt_epi32(zero, newCol), numCols));
+    newCol = _mm256_sub_epi32(newCol, _mm256_andnot_si256(_mm256_cmpgt_epi32(numCols, newCol), numCols));
+
+    __m256i wordIndex = _mm256_add_epi32(_mm256_mullo_epi32(newRow, halfWordsPerRow), _mm256_srli_epi32(newCol, 5));
+    __m256i words = _mm256_i32gather_epi32((const AliasedInt32*) grid.obstacleWords, wordIndex, 4);
+    __m256i bits = _mm256_and_si256(_mm256_srlv_epi32(words, _mm256_and_si256(newCol, bitIndexMask)), one);
+    __m256i isFree = _mm256_cmpeq_epi32(bits, zero);
+
+    _mm256_storeu_si256((__m256i*) (rows + i), _mm256_blendv_epi8(row, newRow, isFree));
+    _mm256_storeu_si256((__m256i*) (cols + i), _mm256_blendv_epi8(col, newCol, isFree));
+    _mm256_storeu_si256((__m256i*) (statuses + i), _mm256_blendv_epi8(blocked, completed, isFree));
+  }
+  stepLockstepScalar(grid, sign, rows, cols, dirs, statuses, i, count);
+}
+#endif
+
+/**
+ * Represents a fleet of rovers sharing one grid
+ *
+ * Rover state is kept as structure-of-arrays (one packed array each for rows,
+ * cols and directions) so updating the whole fleet is a tight loop over
+ * contiguous memory rather than a walk over individual Rover objects.
+ * Rovers are addressed by the index addRover returned.
+ *
+ * On a grid with rover occupancy enabled, fleet rovers hold their cells like
+ * any other rover and are blocked by each other and by standalone rovers.
+ **/
+class Fleet {
+public:
+  /**
+   * Constructs an empty fleet on a shared grid
+   **/
+  Fleet(std::shared_ptr<const Grid> grid) {
+    if (!grid) {
+      throw std::runtime_error("Fleet needs a grid");
+    }
+    this->grid = std::move(grid);
+    this->occupancy = this->grid->getOccupancy();
+  }
+
+  Fleet(Fleet&&) = default;
+  Fleet(const Fleet&) = delete;
+  Fleet& operator=(const Fleet&) = delete;
+
+  /**
+   * Frees the fleet's cells for other rovers
+   **/
+  ~Fleet() {
+    if (this->occupancy) {
+      for (size_t rover = 0; rover < this->size(); rover++) {
+        this->occupancy->release(this->rows[rover], this->cols[rover], this->ids[rover]);
+      }
+    }
+  }
+
+  /**
+   * Adds a rover at the given (row, col) position and direction
+   * Returns the rover's index in the fleet
+   **/
+  size_t addRover(int row, int col, Direction dir) {
+    if (!this->grid->isValidLocation(row, col)) {
+      throw std::runtime_error("Rover cannot be placed here");
+    }
+    if (dir < NORTH || dir > WEST) {
+      throw std::runtime_error("Invalid direction");
+    }
+    if (this->occupancy) {
+      uint32_t id = this->occupancy->newRoverId();
+      if (!this->occupancy->tryOccupy(row, col, id)) {
+        throw std::runtime_error("Rover cannot be placed here");
+      }
+      this->ids.push_back(id);
+    }
+    this->rows.push_back(row);
+    this->cols.push_back(col);
+    this->dirs.push_back((uint8_t) dir);
+    return this->rows.size() - 1;
+  }
+
+  /**
+   * GETTERS
+   **/
+  size_t size() const { return this->rows.size(); }
+  int getRow(size_t rover) const { return this->rows[rover]; }
+  int getCol(size_t rover) const { return this->cols[rover]; }
+  int getDir(size_t rover) const { return this->dirs[rover]; }
+
+  /**
+   * Raw state arrays, indexed by rover
+   **/
+  const int* getRows() const { return this->rows.data(); }
+  const int* getCols() const { return this->cols.data(); }
+  const uint8_t* getDirs() const { return this->dirs.data(); }
+
+  /**
+   * MOVEMENT
+   **/
+
+  /**
+   * Applies one command to every rover: commands[i] moves rover i
+   * statuses[i] is set to how rover i's command went. A blocked rover or an
+   * invalid command leaves that rover where it is. Never throws
+   *
+   * When rovers avoid each other all rovers move simultaneously: a contested
+   * cell goes to the lowest rover id, and a cell held at the start of the
+   * step cannot be entered during it, even by a rover that follows its holder
+   **/
+  void step(const char* commands, MoveStatus* statuses) {
+    if (this->occupancy) {
+      settleStep([commands](size_t rover) { return commands[rover]; }, statuses, SerialRovers(this->size()));
+      return;
+    }
+    stepRovers(0, this->size(), commands, statuses);
+  }
+
+  /**
+   * Same as step(commands, statuses), with command i read from a packed tape
+   * The tape is unpacked a block at a time as the rovers are stepped
+   * Throws when the tape does not hold one command per rover
+   **/
+  void step(const PackedTape& commands, MoveStatus* statuses) {
+    throwOnTapeSize(commands);
+    if (this->occupancy) {
+      const uint8_t* packed = commands.getBytes().data();
+      settleStep([packed](size_t rover) { return packedCommand(packed, rover); }, statuses, SerialRovers(this->size()));
+      return;
+    }
+    StepKernel kernel = bestStepKernel();
+    char block[PACKED_BLOCK_COMMANDS];
+    for (size_t first = 0; first < this->size(); first += PACKED_BLOCK_COMMANDS) {
+      size_t count = std::min(PACKED_BLOCK_COMMANDS, this->size() - first);
+      unpackCommands(commands.getBytes().data() + first / 4, count, block, kernel);
+      stepRovers(first, count, block, statuses + first);
+    }
+  }
+
+  /**
+   * Same as step(commands, statuses), with the rovers spread over a pool
+   * The outcome is the same however the rovers are scheduled
+   **/
+  void step(const char* commands, MoveStatus* statuses, WorkStealingPool& pool) {
+    stepPooled([commands](size_t rover) { return commands[rover]; }, statuses, pool);
+  }
+
+  /**
+   * Same as step(commands, statuses, pool), with command i read from a packed tape
+   * Throws when the tape does not hold one command per rover
+   **/
+  void step(const PackedTape& commands, MoveStatus* statuses, WorkStealingPool& pool) {
+    throwOnTapeSize(commands);
+    const uint8_t* packed = commands.getBytes().data();
+    stepPooled([packed](size_t rover) { return packedCommand(packed, rover); }, statuses, pool);
+  }
+
+  /**
+   * Applies the same command to every rover, on the fastest kernel the CPU supports
+   * Gives the same result as step() with every command set to command.
+   * Rovers that avoid each other are stepped without SIMD
+   **/
+  void stepAll(char command, MoveStatus* statuses) {
+    stepAll(command, statuses, bestStepKernel());
+  }
+
+  /**
+   * Applies the same command to every rover, on the given kernel
+   * Falls back to the scalar kernel when the CPU or grid size rules the kernel out
+   **/
+  void stepAll(char command, MoveStatus* statuses, StepKernel kernel) {
+    size_t numRovers = this->size();
+    if (this->occupancy) {
+      settleStep([command](size_t) { return command; }, statuses, SerialRovers(numRovers));
+    } else if (command == 'F' || command == 'B') {
+      LockstepGrid lockstepGrid;
+      lockstepGrid.obstacleWords = this->grid->getObstacleWords();
+      lockstepGrid.wordsPerRow = this->grid->getWordsPerRow();
+      lockstepGrid.numRows = this->grid->getNumRows();
+      lockstepGrid.numCols = this->grid->getNumCols();
+
+      // Gathers use 32-bit indices of 32-bit half words
+      size_t numHalfWords = 2 * (size_t) lockstepGrid.numRows * lockstepGrid.wordsPerRow;
+      if (!isStepKernelSupported(kernel) || numHalfWords > (size_t) INT32_MAX) {
+        kernel = KERNEL_SCALAR;
+      }
+
+      int sign = command == 'F' ? 1 : -1;
+      int* rowData = this->rows.data();
+      int* colData = this->cols.data();
+      const uint8_t* dirData = this->dirs.data();
+      switch (kernel) {
+#ifdef ROVER_X86_KERNELS
+        case KERNEL_AVX2: {
+          stepLockstepAvx2(lockstepGrid, sign, rowData, colData, dirData, statuses, numRovers);
+          break;
+        }
+        case KERNEL_SSE42: {
+          stepLockstepSse42(lockstepGrid, sign, rowData, colData, dirData, statuses, numRovers);
+          break;
+        }
+#endif
+        default: {
+          stepLockstepScalar(lockstepGrid, sign, rowData, colData, dirData, statuses, 0, numRovers);
+          break;
+        }
+      }
+    } else if (command == 'L' || command == 'R') {
+      for (size_t i = 0; i < numRovers; i++) {
+        this->dirs[i] = COMMAND_TABLE.decode(this->dirs[i], command).dir;
+        statuses[i] = MOVE_COMPLETED;
+      }
+    } else {
+      std::fill(statuses, statuses + numRovers, MOVE_INVALID_COMMAND);
+    }
+  }
+
+  /**
+   * Runs tapes[i] on rover i, each rover stopping at its first obstacle or
+   * invalid command, exactly as Rover::tryMove would. Throws only when there
+   * are more tapes than rovers
+   *
+   * Rovers that ignore each other run one after the other in index order.
+   * Rovers that avoid each other advance in lockstep, one command each per
+   * tick, every tick settled like step(); a rover drops out once its tape
+   * ends or a command fails
+   **/
+  std::vector<MoveResult> move(const std::vector<std::string>& tapes) {
+    std::vector<CommandText> borrowed(tapes.begin(), tapes.end());
+    return move(borrowed.data(), borrowed.size());
+  }
+
+  /**
+   * Same as move(tapes), with the tapes borrowed from numTapes command strings
+   **/
+  std::vector<MoveResult> move(const CommandText* tapes, size_t numTapes) {
+    throwOnTapeCount(numTapes);
+    if (this->occupancy) {
+      return moveLockstep(numTapes, [&](size_t rover) { return tapes[rover].size(); },
+                          [&](size_t rover, size_t index) { return tapes[rover][index]; }, SerialRovers(this->size()));
+    }
+    return moveEach(numTapes, [&](size_t rover) {
+      return moveRover(rover, tapes[rover].data(), tapes[rover].data() + tapes[rover].size());
+    });
+  }
+
+  /**
+   * Same as move(tapes), with each tape unpacked a block at a time
+   **/
+  std::vector<MoveResult> move(const std::vector<PackedTape>& tapes) {
+    throwOnTapeCount(tapes.size());
+    if (this->occupancy) {
+      return moveLockstep(tapes.size(), [&](size_t rover) { return tapes[rover].getNumCommands(); },
+                          [&](size_t rover, size_t index) { return packedCommand(tapes[rover].getBytes().data(), index); },
+                          SerialRovers(this->size()));
+    }
+    return moveEach(tapes.size(), [&](size_t rover) {
+      return moveRoverPacked(rover, tapes[rover]);
+    });
+  }
+
+  /**
+   * Same as move(tapes), with the rovers spread over a work-stealing pool
+   *
+   * The results match move(tapes) whatever the schedule. Rovers that ignore
+   * each other are independent, so each one's tape runs on whichever thread
+   * picks it up; rovers that avoid each other spread every lockstep tick over
+   * the pool. The grid is only read; it must not be changed while the call runs.
+   * chunkSize rovers are handed out at a time, 0 picks a size from the pool width
+   **/
+  std::vector<MoveResult> move(const std::vector<std::string>& tapes, WorkStealingPool& pool, size_t chunkSize = 0) {
+    std::vector<CommandText> borrowed(tapes.begin(), tapes.end());
+    return move(borrowed.data(), borrowed.size(), pool, chunkSize);
+  }
+
+  /**
+   * Same as move(tapes, numTapes), with the rovers spread over a work-stealing pool
+   **/
+  std::vector<MoveResult> move(const CommandText* tapes, size_t numTapes, WorkStealingPool& pool, size_t chunkSize = 0) {
+    throwOnTapeCount(numTapes);
+    if (this->occupancy) {
+      return moveLockstep(numTapes, [&](size_t rover) { return tapes[rover].size(); },
+                          [&](size_t rover, size_t index) { return tapes[rover][index]; },
+                          PooledRovers(pool, this->size(), chunkSize));
+    }
+    return moveEach(numTapes, pool, chunkSize, [&](size_t rover) {
+      return moveRover(rover, tapes[rover].data(), tapes[rover].data() + tapes[rover].size());
+    });
+  }
+
+  /**
+   * Same as move(packed tapes), with the rovers spread over a work-stealing pool
+   **/
+  std::vector<MoveResult> move(const std::vector<PackedTape>& tapes, WorkStealingPool& pool, size_t chunkSize = 0) {
+    throwOnTapeCount(tapes.size());
+    if (this->occupancy) {
+      return moveLockstep(tapes.size(), [&](size_t rover) { return tapes[rover].getNumCommands(); },
+                          [&](size_t rover, size_t index) { return packedCommand(tapes[rover].getBytes().data(), index); },
+                          PooledRovers(pool, this->size(), chunkSize));
+    }
+    return moveEach(tapes.size(), pool, chunkSize, [&](size_t rover) {
+      return moveRoverPacked(rover, tapes[rover]);
+    });
+  }
+
+private:
+  /**
+   * Grid the whole fleet sits on
+   **/
+  std::shared_ptr<const Grid> grid;
+
+  /**
+   * The grid's rover occupancy layer, or nullptr if rovers ignore each other
+   **/
+  OccupancyLayer* occupancy;
+
+  /**
+   * Rover state, one entry per rover
+   **/
+  std::vector<int> rows;
+  std::vector<int> cols;
+  std::vector<uint8_t> dirs;
+
+  /**
+   * Occupancy layer id of each rover, only kept when rovers avoid each other
+   * Ids rise with the rover index
+   **/
+  std::vector<uint32_t> ids;
+
+  /**
+   * Serial step of the count rovers from first on, commands[i] and statuses[i]
+   * belonging to rover first + i. Only for rovers that ignore each other
+   **/
+  void stepRovers(size_t first, size_t count, const char* commands, MoveStatus* statuses) {
+    int numRows = this->grid->getNumRows();
+    int numCols = this->grid->getNumCols();
+    int* rowData = this->rows.data() + first;
+    int* colData = this->cols.data() + first;
+    uint8_t* dirData = this->dirs.data() + first;
+
+    for (size_t i = 0; i < count; i++) {
+      const CommandStep& step = COMMAND_TABLE.decode(dirData[i], commands[i]);
+      int isMove = (step.rowStep | step.colStep) != 0;
+
+      // Unit steps never leave the grid by more than one cell, so a compare wraps them
+      int newRow = rowData[i] + step.rowStep;
+      int newCol = colData[i] + step.colStep;
+      newRow += newRow < 0 ? numRows : 0;
+      newRow -= newRow >= numRows ? numRows : 0;
+      newCol += newCol < 0 ? numCols : 0;
+      newCol -= newCol >= numCols ? numCols : 0;
+
+      bool isFree = this->grid->isValidLocation(newRow, newCol);
+      bool isMoved = isMove && isFree;
+      rowData[i] = isMoved ? newRow : rowData[i];
+      colData[i] = isMoved ? newCol : colData[i];
+      dirData[i] = step.dir;
+      statuses[i] = (isMove && !isFree) ? MOVE_BLOCKED : (step.isValid ? MOVE_COMPLETED : MOVE_INVALID_COMMAND);
+    }
+  }
+
+  /**
+   * Runs a task for every rover, in index order
+   * only() narrows it to a list of rover indices, visited in list order
+   **/
+  struct SerialRovers {
+    size_t numRovers;
+    const size_t* rovers;
+
+    explicit SerialRovers(size_t numRovers, const size_t* rovers = nullptr) : numRovers(numRovers), rovers(rovers) {}
+
+    SerialRovers only(const size_t* list, size_t count) const {
+      return SerialRovers(count, list);
+    }
+
+    template <typename Task>
+    void operator()(const Task& task) const {
+      for (size_t i = 0; i < this->numRovers; i++) {
+        task(this->rovers ? this->rovers[i] : i);
+      }
+    }
+  };
+
+  /**
+   * Runs a task for every rover, spread over a pool
+   * chunkSize rovers are handed out at a time, 0 picks a size from the pool width
+   * only() narrows it to a list of rover indices
+   **/
+  struct PooledRovers {
+    WorkStealingPool& pool;
+    size_t numRovers;
+    size_t requestedChunkSize;
+    size_t chunkSize;
+    const size_t* rovers;
+
+    PooledRovers(WorkStealingPool& pool, size_t numRovers, size_t chunkSize, const size_t* rovers = nullptr)
+        : pool(pool), numRovers(numRovers), requestedChunkSize(chunkSize), chunkSize(chunkSize), rovers(rovers) {
+      if (this->chunkSize == 0) {
+        this->chunkSize = std::max<size_t>(1, numRovers / (64 * (size_t) pool.getNumThreads()));
+      }
+    }
+
+    PooledRovers only(const size_t* list, size_t count) const {
+      return PooledRovers(this->pool, count, this->requestedChunkSize, list);
+    }
+
+    template <typename Task>
+    void operator()(const Task& task) const {
+      const size_t* list = this->rovers;
+      if (!list) {
+        this->pool.parallelFor(this->numRovers, this->chunkSize, task);
+        return;
+      }
+      this->pool.parallelFor(this->numRovers, this->chunkSize, [&task, list](size_t i) { task(list[i]); });
+    }
+  };
+
+  /**
+   * Per-rover scratch for settleStep, indexed by rover and only touched for
+   * the rovers a step visits, so one set serves every tick of a move
+   **/
+  struct SettleBuffers {
+    std::vector<int> targetRows;
+    std::vector<int> targetCols;
+    std::vector<uint8_t> isWinner;
+
+    explicit SettleBuffers(size_t numRovers) : targetRows(numRovers), targetCols(numRovers), isWinner(numRovers) {}
+  };
+
+  /**
+   * Pooled step, with commandAt(i) giving rover i's command
+   **/
+  template <typename CommandAt>
+  void stepPooled(const CommandAt& commandAt, MoveStatus* statuses, WorkStealingPool& pool) {
+    PooledRovers forEachRover(pool, this->size(), 0);
+    if (this->occupancy) {
+      settleStep(commandAt, statuses, forEachRover);
+      return;
+    }
+    forEachRover([&](size_t rover) {
+      char command = commandAt(rover);
+      statuses[rover] = moveRover(rover, &command, &command + 1).status;
+    });
+  }
+
+  /**
+   * Settles one simultaneous step of rovers that avoid each other
+   *
+   * Three lock-free passes, each run over every rover by forEachRover: every
+   * mover bids for its target cell, every bidder checks whether it won, and
+   * the winners move in. A contested cell goes to the lowest rover id, and a
+   * cell held at the start of the step cannot be entered during it, so the
+   * outcome does not depend on the order the rovers are visited in
+   **/
+  template <typename CommandAt, typename ForEach>
+  void settleStep(const CommandAt& commandAt, MoveStatus* statuses, const ForEach& forEachRover) {
+    SettleBuffers buffers(this->size());
+    settleStep(commandAt, statuses, forEachRover, buffers);
+  }
+
+  /**
+   * Same as settleStep(commandAt, statuses, forEachRover), reusing buffers
+   * Rovers forEachRover does not visit are neither moved nor given a status
+   **/
+  template <typename CommandAt, typename ForEach>
+  void settleStep(const CommandAt& commandAt, MoveStatus* statuses, const ForEach& forEachRover, SettleBuffers& buffers) {
+    std::vector<int>& targetRows = buffers.targetRows;
+    std::vector<int>& targetCols = buffers.targetCols;
+    std::vector<uint8_t>& isWinner = buffers.isWinner;
+
+    // Pass 1: turn, stop at obstacles, and bid for the cell ahead
+    forEachRover([&](size_t rover) {
+      targetRows[rover] = -1;
+      targetCols[rover] = -1;
+      char command = commandAt(rover);
+      if (command != 'F' && command != 'B') {
+        statuses[rover] = moveRover(rover, &command, &command + 1).status;
+        return;
+      }
+      int sign = command == 'F' ? 1 : -1;
+      int dir = this->dirs[rover];
+      int newRow = this->grid->wrapStepRow(this->rows[rover] + sign * DIRECTION_ROW_STEP[dir]);
+      int newCol = this->grid->wrapStepCol(this->cols[rover] + sign * DIRECTION_COL_STEP[dir]);
+      if (!this->grid->isValidLocation(newRow, newCol)) {
+        statuses[rover] = MOVE_BLOCKED;
+      } else if (newRow == this->rows[rover] && newCol == this->cols[rover]) {
+        statuses[rover] = MOVE_COMPLETED;
+      } else {
+        targetRows[rover] = newRow;
+        targetCols[rover] = newCol;
+        this->occupancy->reserve(newRow, newCol, this->ids[rover]);
+      }
+    });
+
+    // Pass 2: nobody has moved yet, so every bidder sees the same holders and bids
+    forEachRover([&](size_t rover) {
+      int row = targetRows[rover];
+      int col = targetCols[rover];
+      isWinner[rover] = 0;
+      if (row < 0) {
+        return;
+      }
+      isWinner[rover] = this->occupancy->getReservation(row, col) == this->ids[rover] &&
+                        !this->occupancy->isOccupied(row, col);
+    });
+
+    // Pass 3: winners move in, and reservations are reset for the next step
+    forEachRover([&](size_t rover) {
+      int row = targetRows[rover];
+      int col = targetCols[rover];
+      if (row < 0) {
+        return;
+      }
+      this->occupancy->clearReservation(row, col);
+      // A standalone rover on another thread may still take the cell first
+      if (!isWinner[rover] || !this->occupancy->tryOccupy(row, col, this->ids[rover])) {
+        statuses[rover] = MOVE_BLOCKED_BY_ROVER;
+        return;
+      }
+      this->occupancy->release(this->rows[rover], this->cols[rover], this->ids[rover]);
+      this->rows[rover] = row;
+      this->cols[rover] = col;
+      statuses[rover] = MOVE_COMPLETED;
+    });
+  }
+
+  /**
+   * Throws unless a packed step tape holds exactly one command per rover
+   **/
+  void throwOnTapeSize(const PackedTape& commands) const {
+    if (commands.getNumCommands() != this->size()) {
+      throw std::runtime_error("Packed tape size does not match the fleet size");
+    }
+  }
+
+  /**
+   * Throws unless there is a rover for each of numTapes tapes
+   **/
+  void throwOnTapeCount(size_t numTapes) const {
+    if (numTapes > this->size()) {
+      throw std::invalid_argument("More tapes than rovers in the fleet");
+    }
+  }
+
+  /**
+   * Runs runTape(i) for each of the first numTapes rovers, in index order
+   **/
+  template <typename RunTape>
+  std::vector<MoveResult> moveEach(size_t numTapes, const RunTape& runTape) {
+    std::vector<MoveResult> results(numTapes);
+    for (size_t rover = 0; rover < numTapes; rover++) {
+      results[rover] = runTape(rover);
+    }
+    return results;
+  }
+
+  /**
+   * Runs runTape(i) for each of the first numTapes rovers, spread over a pool
+   **/
+  template <typename RunTape>
+  std::vector<MoveResult> moveEach(size_t numTapes, WorkStealingPool& pool, size_t chunkSize, const RunTape& runTape) {
+    std::vector<MoveResult> results(numTapes);
+    if (chunkSize == 0) {
+      chunkSize = std::max<size_t>(1, numTapes / (64 * (size_t) pool.getNumThreads()));
+    }
+    pool.parallelFor(numTapes, chunkSize, [&](size_t rover) {
+      results[rover] = runTape(rover);
+    });
+    return results;
+  }
+
+  /**
+   * Runs the first numTapes rovers' tapes in lockstep, settling every tick
+   * with settleStep. lengthOf(i) is the length of rover i's tape and
+   * commandOf(i, t) its command t
+   *
+   * Only rovers still running are settled; stopped rovers keep their cells
+   * and drop out of the active list, so a tick costs what is left running
+   **/
+  template <typename LengthOf, typename CommandOf, typename ForEach>
+  std::vector<MoveResult> moveLockstep(size_t numTapes, const LengthOf& lengthOf, const CommandOf& commandOf,
+                                       const ForEach& forEachRover) {
+    std::vector<MoveResult> results(numTapes);
+    std::vector<size_t> active;
+    for (size_t rover = 0; rover < numTapes; rover++) {
+      results[rover].status = MOVE_COMPLETED;
+      results[rover].commandsConsumed = 0;
+      results[rover].blockedRow = -1;
+      results[rover].blockedCol = -1;
+      if (lengthOf(rover) > 0) {
+        active.push_back(rover);
+      }
+    }
+
+    SettleBuffers buffers(this->size());
+    std::vector<MoveStatus> statuses(this->size());
+    for (size_t tick = 0; !active.empty(); tick++) {
+      settleStep([&](size_t rover) { return commandOf(rover, tick); }, statuses.data(),
+                 forEachRover.only(active.data(), active.size()), buffers);
+      size_t numRunning = 0;
+      for (size_t i = 0; i < active.size(); i++) {
+        size_t rover = active[i];
+        MoveResult& result = results[rover];
+        if (statuses[rover] == MOVE_COMPLETED) {
+          result.commandsConsumed++;
+          if (result.commandsConsumed < lengthOf(rover)) {
+            active[numRunning++] = rover;
+            continue;
+          }
+        } else {
+          result.status = statuses[rover];
+          if (result.status == MOVE_BLOCKED || result.status == MOVE_BLOCKED_BY_ROVER) {
+            // Only 'F' and 'B' are blocked, and neither turns the rover
+            int sign = commandOf(rover, tick) == 'F' ? 1 : -1;
+            int dir = this->dirs[rover];
+            result.blockedRow = this->grid->wrapStepRow(this->rows[rover] + sign * DIRECTION_ROW_STEP[dir]);
+            result.blockedCol = this->grid->wrapStepCol(this->cols[rover] + sign * DIRECTION_COL_STEP[dir]);
+          }
+        }
+      }
+      active.resize(numRunning);
+    }
+
+    for (size_t rover = 0; rover < numTapes; rover++) {
+      results[rover].row = this->rows[rover];
+      results[rover].col = this->cols[rover];
+      results[rover].dir = (Direction) this->dirs[rover];
+    }
+    return results;
+  }
+
+  /**
+   * Runs a packed tape on a single rover, unpacking it a block at a time
+   **/
+  MoveResult moveRoverPacked(size_t rover, const PackedTape& tape) {
+    StepKernel kernel = bestStepKernel();
+    char block[PACKED_BLOCK_COMMANDS];
+    MoveResult result = makeResult(rover, MOVE_COMPLETED, 0);
+    for (size_t first = 0; first < tape.getNumCommands(); first += PACKED_BLOCK_COMMANDS) {
+      size_t count = std::min(PACKED_BLOCK_COMMANDS, tape.getNumCommands() - first);
+      unpackCommands(tape.getBytes().data() + first / 4, count, block, kernel);
+      size_t consumed = result.commandsConsumed;
+      result = moveRover(rover, block, block + count);
+      result.commandsConsumed += consumed;
+      if (result.status != MOVE_COMPLETED) {
+        break;
+      }
+    }
+    return result;
+  }
+
+  /**
+   * Result of a move that leaves rover where it currently is
+   **/
+  MoveResult makeResult(size_t rover, MoveStatus status, size_t commandsConsumed) const {
+    MoveResult result;
+    result.status = status;
+    result.commandsConsumed = commandsConsumed;
+    result.row = this->rows[rover];
+    result.col = this->cols[rover];
+    result.dir = (Direction) this->dirs[rover];
+    result.blockedRow = -1;
+    result.blockedCol = -1;
+    return result;
+  }
+
+  /**
+   * Runs the commands in [begin, end) on a single rover
+   **/
+  MoveResult moveRover(size_t rover, const char* begin, const char* end) {
+    MoveResult result;
+    result.status = MOVE_COMPLETED;
+    result.commandsConsumed = 0;
+    result.blockedRow = -1;
+    result.blockedCol = -1;
+
+    int row = this->rows[rover];
+    int col = this->cols[rover];
+    int dir = this->dirs[rover];
+    for (const char* command = begin; command != end; command++) {
+      const CommandStep& step = COMMAND_TABLE.decode(dir, *command);
+      if (!step.isValid) {
+        result.status = MOVE_INVALID_COMMAND;
+        break;
+      }
+      dir = step.dir;
+      if (step.rowStep != 0 || step.colStep != 0) {
+        int newRow = this->grid->wrapStepRow(row + step.rowStep);
+        int newCol = this->grid->wrapStepCol(col + step.colStep);
+        if (!this->grid->isValidLocation(newRow, newCol)) {
+          result.status = MOVE_BLOCKED;
+          result.blockedRow = newRow;
+          result.blockedCol = newCol;
+          break;
+        }
+        if (this->occupancy && (newRow != row || newCol != col)) {
+          if (!this->occupancy->tryOccupy(newRow, newCol, this->ids[rover])) {
+            result.status = MOVE_BLOCKED_BY_ROVER;
+            result.blockedRow = newRow;
+            result.blockedCol = newCol;
+            break;
+          }
+          this->occupancy->release(row, col, this->ids[rover]);
+        }
+        row = newRow;
+        col = newCol;
+      }
+      result.commandsConsumed++;
+    }
+
+    this->rows[rover] = row;
+    this->cols[rover] = col;
+    this->dirs[rover] = (uint8_t) dir;
+    result.row = row;
+    result.col = col;
+    result.dir = (Direction) dir;
+    return result;
+  }
+};
+
+
+/**
+ * TESTS GO HERE
+ **/
+
+// Testing Grid class
+TEST_CASE( "Grid Construction Test", "[grid]" ) {
+    Grid grid = Grid(1, 4);
+    REQUIRE( grid.getNumRows() == 1 );
+    REQUIRE( grid.getNumCols() == 4 );
+}
+
+TEST_CASE( "Grid Obstacle Test", "[grid]" ) {
+    Grid grid = Grid(4, 4);
+    grid.putObstacle(1,1);
+    grid.putObstacle(2,2);
     REQUIRE( grid.isValidLocation(1,1) == false );
     REQUIRE( grid.isValidLocation(2,2) == false );
     REQUIRE( grid.isValidLocation(0,2) == true );
     REQUIRE( grid.isValidLocation(10,10) == false );
 }
 
+TEST_CASE( "Grid bitset layout Test", "[grid]" ) {
+    Grid grid = Grid(3, 130);
+    REQUIRE( grid.getWordsPerRow() == 3 );
+
+    grid.putObstacle(1, 0);
+    grid.putObstacle(1, 65);
+    grid.putObstacle(2, 129);
+    // Out of bounds obstacles are ignored and never touch the padding bits
+    grid.putObstacle(2, 130);
+
+    const uint64_t* words = grid.getObstacleWords();
+    REQUIRE( words[0] == 0 );
+    REQUIRE( grid.getRowWords(1) == words + 3 );
+    REQUIRE( grid.getRowWords(1)[0] == 1 );
+    REQUIRE( grid.getRowWords(1)[1] == 2 );
+    REQUIRE( grid.getRowWords(2)[2] == 2 );
+    REQUIRE( grid.isValidLocation(1, 65) == false );
+    REQUIRE( grid.isValidLocation(1, 64) == true );
+}
+
+
+TEST_CASE( "Grid column view is built on the first column scan", "[grid]" ) {
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(130, 70);
+    grid->putObstacle(100, 3);
+    grid->putObstacle(2, 69);
+    REQUIRE( !grid->getStorage().hasColumnView() );
+
+    // Runs along a row never need the column view
+    Rover rov = Rover(100, 0, EAST, grid);
+    REQUIRE( rov.tryMove(CompiledTape("FFF")).status == MOVE_BLOCKED );
+    REQUIRE( !grid->getStorage().hasColumnView() );
+
+    rov.move("LF");
+    REQUIRE( rov.tryMove(CompiledTape("RRFFFFFFFF")).status == MOVE_COMPLETED );
+    REQUIRE( grid->getStorage().hasColumnView() );
+
+    // Once built, writes keep it in step with the rows, copies included
+    grid->putObstacle(50, 2);
+    grid->removeObstacle(100, 3);
+    Grid copy = *grid;
+    copy.putObstacle(129, 2);
+    for (const Grid* view : { grid.get(), &copy }) {
+        for (int col = 0; col < 70; col++) {
+            for (int row = 0; row < 130; row++) {
+                bool isSet = ((view->getColWords(col)[row / 64] >> (row % 64)) & 1) != 0;
+                REQUIRE( isSet == !view->isValidLocation(row, col) );
+            }
+        }
+    }
+    REQUIRE( grid->isValidLocation(129, 2) );
+}
+
+// Testing Rover class
+TEST_CASE( "Rover Construction Test", "[rover]" ) {
+    Rover rov = Rover(1, 4, NORTH, Grid(5, 5));
+    REQUIRE( rov.getRow() == 1 );
+    REQUIRE( rov.getCol() == 4 );
+}
+
+TEST_CASE( "Rover Shared Grid Test", "[rover]" ) {
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(4, 4);
+    Rover first = Rover(0, 0, NORTH, grid);
+    Rover second = Rover(0, 1, NORTH, grid);
+    // Both rovers reference the caller's grid rather than owning copies
+    REQUIRE( grid.use_count() == 3 );
+
+    // Obstacles placed after construction are seen by every rover
+    grid->putObstacle(1, 0);
+    grid->putObstacle(1, 1);
+    REQUIRE_THROWS_AS(first.move('F'), std::runtime_error);
+    REQUIRE_THROWS_AS(second.move('F'), std::runtime_error);
+    REQUIRE_THROWS_AS(Rover(1, 1, NORTH, grid), std::runtime_error);
+
+    // A private snapshot is asked for explicitly and misses later obstacles
+    Rover isolated = Rover(0, 2, NORTH, std::make_shared<const Grid>(*grid));
+    grid->putObstacle(1, 2);
+    REQUIRE( isolated.tryMove('F').status == MOVE_COMPLETED );
+    REQUIRE( grid.use_count() == 3 );
+}
+
+TEST_CASE( "Rover Invalid Construction Test", "[rover]" ) {
+    // Rover would not fit on this grid
+    REQUIRE_THROWS_AS(Rover(1, 4, NORTH, Grid(1, 1)), std::runtime_error);
+
+    // Nor this one
+    REQUIRE_THROWS_AS(Rover(0, 4, NORTH, Grid(1, 4)), std::runtime_error);
+}
+
+// Rover Movement TESTS
+TEST_CASE( "Rover basic movement Test", "[rover]" ) {
+    Rover rov = Rover(0, 0, NORTH, Grid(4, 4));
+
+    rov.move('F');
+    // Rover should now be at 1, 0
+    REQUIRE( rov.getRow() == 1 );
+    REQUIRE( rov.getCol() == 0 );
+
+    rov.move('B');
+    // Rover should now be at 0, 0
+    REQUIRE( rov.getRow() == 0 );
+    REQUIRE( rov.getCol() == 0 );
+
+    // Should wrap back to zero
+    rov.move('F');
+    rov.move('F');
+    rov.move('F');
+    rov.move('F');
+    REQUIRE( rov.getRow() == 0 );
+    REQUIRE( rov.getCol() == 0 );
+}
+
+TEST_CASE( "Rover basic obstacle movement Test", "[rover]" ) {
+    Grid grid = Grid(4,4);
+    // Place obstacles
+    grid.putObstacle(1,1);
+    grid.putObstacle(2,0);
+    Rover rov = Rover(0, 0, NORTH, std::make_shared<const Grid>(grid));
+
+    rov.move('F');
+    // Rover should now be at 1, 0
+    REQUIRE( rov.getRow() == 1 );
+    REQUIRE( rov.getCol() == 0 );
+
+    REQUIRE_THROWS_AS(rov.move('F'), std::runtime_error);
+
+    // Error when attempting to move right
+    rov.move('R');
+    REQUIRE_THROWS_AS(rov.move('F'), std::runtime_error);
+}
+
+TEST_CASE( "Rover complicated obstacle movement test", "[rover]" ) {
+    Grid grid = Grid(4,4);
+    grid.putObstacle(1,1);
+    Rover rov = Rover(0, 0, NORTH, std::make_shared<const Grid>(grid));
+
+    rov.move('F');
+    rov.move('R');
+    REQUIRE( rov.getRow() == 1 );
+    REQUIRE( rov.getCol() == 0 );
+    REQUIRE( rov.getDir() == EAST );
+
+    REQUIRE_THROWS_AS(rov.move('F'), std::runtime_error);
+
+    rov.move('L');
+    rov.move('F');
+    rov.move('R');
+    rov.move('F');
+    rov.move('R');
+    REQUIRE( rov.getRow() == 2 );
+    REQUIRE( rov.getCol() == 1 );
+    REQUIRE( rov.getDir() == SOUTH );
+
+    REQUIRE_THROWS_AS(rov.move('F'), std::runtime_error);
+
+    // Wrap around and approach obstancle from other side
+    rov.move('L');
+    rov.move('L');
+    rov.move('F');
+    rov.move('F');
+    REQUIRE( rov.getRow() == 0 );
+    REQUIRE( rov.getCol() == 1 );
+    REQUIRE_THROWS_AS(rov.move('F'), std::runtime_error);
+}
+
+
+TEST_CASE( "Rover basic rotation Test", "[rover]" ) {
+    Rover rov = Rover(0, 0, NORTH, Grid(4, 4));
+
+    rov.move('R');
+    REQUIRE( rov.getDir() == EAST );
+
+    rov.move('L');
+    REQUIRE( rov.getDir() == NORTH );
+
+    rov.move('L');
+    rov.move('L');
+    REQUIRE( rov.getDir() == SOUTH );
+
+    // Should wrap back to NORTH
+    rov.move('L');
+    rov.move('L');
+    REQUIRE( rov.getDir() == NORTH );
+}
+
+TEST_CASE( "Rover String input test", "[rover]" ) {
+    Rover rov = Rover(0, 0, NORTH, Grid(4, 4));
+
+    rov.move("FFFFFF");
+    REQUIRE( rov.getRow() == 2 );
+    REQUIRE( rov.getCol() == 0 );
+
+    rov.move("RF");
+    REQUIRE( rov.getRow() == 2 );
+    REQUIRE( rov.getCol() == 1 );
+
+    rov.move("RRLLB");
+    REQUIRE( rov.getRow() == 2 );
+    REQUIRE( rov.getCol() == 0 );
+}
+
+TEST_CASE( "Rover non-throwing movement test", "[rover]" ) {
+    Grid grid = Grid(4,4);
+    grid.putObstacle(2,0);
+    Rover rov = Rover(0, 0, NORTH, std::make_shared<const Grid>(grid));
+
+    MoveResult result = rov.tryMove("RLFFRF");
+    REQUIRE( result.status == MOVE_BLOCKED );
+    REQUIRE( result.commandsConsumed == 3 );
+    REQUIRE( result.row == 1 );
+    REQUIRE( result.col == 0 );
+    REQUIRE( result.dir == NORTH );
+    REQUIRE( result.blockedRow == 2 );
+    REQUIRE( result.blockedCol == 0 );
+
+    result = rov.tryMove("RFX");
+    REQUIRE( result.status == MOVE_INVALID_COMMAND );
+    REQUIRE( result.commandsConsumed == 2 );
+    REQUIRE( result.row == 1 );
+    REQUIRE( result.col == 1 );
+    REQUIRE( result.dir == EAST );
+    REQUIRE( result.blockedRow == -1 );
+
+    result = rov.tryMove('F');
+    REQUIRE( result.status == MOVE_COMPLETED );
+    REQUIRE( result.commandsConsumed == 1 );
+    REQUIRE( result.col == 2 );
+
+    // The throwing API reports the same failures as exceptions
+    REQUIRE_THROWS_WITH(rov.move("LFLFF"), "Obstacle encountered at: 2, 0");
+    REQUIRE_THROWS_WITH(rov.move('?'), "Invalid movement");
+}
+
+TEST_CASE( "Compiled tape run-length test", "[tape]" ) {
+    CompiledTape tape = CompiledTape("FFFFLLRBBQFF");
+    REQUIRE( tape.getNumCommands() == 9 );
+    REQUIRE( tape.getOps().size() == 4 );
+    REQUIRE( tape.getOps()[0].kind == TAPE_FORWARD );
+    REQUIRE( tape.getOps()[0].count == 4 );
+    REQUIRE( tape.getOps()[1].kind == TAPE_ROTATE );
+    REQUIRE( tape.getOps()[1].rotation[NORTH] == WEST );
+    REQUIRE( tape.getOps()[2].kind == TAPE_BACKWARD );
+    REQUIRE( tape.getOps()[3].kind == TAPE_INVALID );
+
+    // A run wraps around the planet and stops right before the obstacle
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(5, 70);
+    grid->putObstacle(2, 1);
+    Rover rov = Rover(2, 3, EAST, grid);
+    MoveResult result = rov.tryMove(CompiledTape(std::string(1000, 'F')));
+    REQUIRE( result.status == MOVE_BLOCKED );
+    REQUIRE( result.commandsConsumed == 67 );
+    REQUIRE( rov.getCol() == 0 );
+    REQUIRE( result.blockedRow == 2 );
+    REQUIRE( result.blockedCol == 1 );
+}
+
+TEST_CASE( "Compiled tape matches per-step movement", "[tape]" ) {
+    std::mt19937 random(7);
+    const char commands[] = "FFFFFBBLRX";
+    for (int trial = 0; trial < 300; trial++) {
+        int numRows = 1 + random() % 140;
+        int numCols = 1 + random() % 140;
+        std::shared_ptr<Grid> grid = std::make_shared<Grid>(numRows, numCols);
+        int numObstacles = random() % (numRows + numCols);
+        for (int i = 0; i < numObstacles; i++) {
+            grid->putObstacle(random() % numRows, random() % numCols);
+        }
+        grid->putObstacle(0, 0);
+
+        // Long runs in every direction, with the occasional invalid command
+        std::string movements;
+        while (movements.size() < 400) {
+            char command = commands[random() % (trial % 2 == 0 ? 9 : 10)];
+            movements.append(1 + random() % 200, command);
+        }
+
+        int row = random() % numRows;
+        int col = random() % numCols;
+        if (!grid->isValidLocation(row, col)) {
+            continue;
+        }
+        Rover stepped = Rover(row, col, (Direction) (random() % 4), grid);
+        Rover compiled = stepped;
+        MoveResult expected = stepped.tryMove(movements);
+        MoveResult actual = compiled.tryMove(CompiledTape(movements));
+        REQUIRE( actual.status == expected.status );
+        REQUIRE( actual.commandsConsumed == expected.commandsConsumed );
+        REQUIRE( actual.row == expected.row );
+        REQUIRE( actual.col == expected.col );
+        REQUIRE( actual.dir == expected.dir );
+        REQUIRE( actual.blockedRow == expected.blockedRow );
+        REQUIRE( actual.blockedCol == expected.blockedCol );
+    }
+}
+
+TEST_CASE( "Pose transform composition test", "[tape]" ) {
+    Grid grid = Grid(5, 7);
+    PoseTransform first = PoseTransform::identity();
+    PoseTransform second = PoseTransform::identity();
+    for (char movement : std::string("FFRFB")) {
+        first.append(movement);
+    }
+    for (char movement : std::string("LBBBFR")) {
+        second.append(movement);
+    }
+    REQUIRE( first.append('X') == false );
+
+    // Composing the two halves matches one transform over the whole sequence
+    PoseTransform whole = PoseTransform::identity();
+    for (char movement : std::string("FFRFBLBBBFR")) {
+        whole.append(movement);
+    }
+    PoseTransform joined = first.then(second);
+    for (int dir = NORTH; dir <= WEST; dir++) {
+        REQUIRE( joined.rowOffset[dir] == whole.rowOffset[dir] );
+        REQUIRE( joined.colOffset[dir] == whole.colOffset[dir] );
+        REQUIRE( joined.finalDir[dir] == whole.finalDir[dir] );
+    }
+
+    Rover rov = Rover(4, 6, NORTH, std::make_shared<const Grid>(grid));
+    rov.move("FFRFBLBBBFR");
+    int row = 4, col = 6;
+    Direction dir = NORTH;
+    whole.apply(grid, row, col, dir);
+    REQUIRE( row == rov.getRow() );
+    REQUIRE( col == rov.getCol() );
+    REQUIRE( dir == rov.getDir() );
+}
+
+TEST_CASE( "Parallel tape execution matches per-step movement", "[tape]" ) {
+    std::mt19937 random(11);
+    const char commands[] = "FFFFBLR";
+    for (int trial = 0; trial < 8; trial++) {
+        std::shared_ptr<Grid> grid = std::make_shared<Grid>(300, 200);
+        // Sparse enough that the rover usually wanders far before being blocked
+        for (int i = 0; i < trial % 4; i++) {
+            grid->putObstacle(random() % 300, random() % 200);
+        }
+        std::string movements(1 << 19, 'F');
+        for (char& movement : movements) {
+            movement = commands[random() % 7];
+        }
+        if (trial >= 4) {
+            movements[50000 * trial] = 'X';
+        }
+        if (!grid->isValidLocation(0, 0)) {
+            continue;
+        }
+
+        Rover stepped = Rover(0, 0, NORTH, grid);
+        Rover parallel = stepped;
+        MoveResult expected = stepped.tryMove(movements);
+        MoveResult actual = parallel.tryMoveParallel(movements, 8);
+        REQUIRE( actual.status == expected.status );
+        REQUIRE( actual.commandsConsumed == expected.commandsConsumed );
+        REQUIRE( actual.row == expected.row );
+        REQUIRE( actual.col == expected.col );
+        REQUIRE( actual.dir == expected.dir );
+        REQUIRE( actual.blockedRow == expected.blockedRow );
+        REQUIRE( actual.blockedCol == expected.blockedCol );
+        REQUIRE( parallel.getRow() == stepped.getRow() );
+        REQUIRE( parallel.getCol() == stepped.getCol() );
+    }
+}
+
+TEST_CASE( "Rover repeated program test", "[repeat]" ) {
+    std::mt19937 random(5);
+    const char commands[] = "FFFBLR";
+    for (int trial = 0; trial < 400; trial++) {
+        int numRows = 1 + random() % 12;
+        int numCols = 1 + random() % 12;
+        std::shared_ptr<Grid> grid = std::make_shared<Grid>(numRows, numCols);
+        int numObstacles = random() % 3;
+        for (int i = 0; i < numObstacles; i++) {
+            grid->putObstacle(random() % numRows, random() % numCols);
+        }
+        if (!grid->isValidLocation(0, 0)) {
+            continue;
+        }
+
+        std::string program;
+        size_t length = 1 + random() % 8;
+        for (size_t i = 0; i < length; i++) {
+            program += commands[random() % 6];
+        }
+        size_t repetitions = random() % 300;
+
+        // Reference: the program spelled out in full
+        std::string spelledOut;
+        for (size_t i = 0; i < repetitions; i++) {
+            spelledOut += program;
+        }
+        Direction dir = (Direction) (random() % 4);
+        Rover stepped = Rover(0, 0, dir, grid);
+        Rover repeated = Rover(0, 0, dir, grid);
+        MoveResult expected = stepped.tryMove(spelledOut);
+        RepeatResult actual = repeated.tryRepeat(program, repetitions);
+
+        REQUIRE( actual.move.status == expected.status );
+        if (expected.status == MOVE_COMPLETED) {
+            REQUIRE( actual.repetitionsCompleted == repetitions );
+        } else {
+            REQUIRE( actual.repetitionsCompleted == expected.commandsConsumed / length );
+            REQUIRE( actual.move.commandsConsumed == expected.commandsConsumed % length );
+            REQUIRE( actual.move.blockedRow == expected.blockedRow );
+            REQUIRE( actual.move.blockedCol == expected.blockedCol );
+        }
+        REQUIRE( repeated.getRow() == stepped.getRow() );
+        REQUIRE( repeated.getCol() == stepped.getCol() );
+        REQUIRE( repeated.getDir() == stepped.getDir() );
+    }
+}
+
+TEST_CASE( "Rover repeated program skips ahead", "[repeat]" ) {
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(1000, 1000);
+    grid->putObstacle(500, 100);
+    Rover rov = Rover(0, 0, NORTH, grid);
+
+    // A trillion passes of a program whose diagonal path never meets the obstacle
+    RepeatResult result = rov.tryRepeat("FFRFFL", 1000000000007ULL);
+    REQUIRE( result.move.status == MOVE_COMPLETED );
+    REQUIRE( result.repetitionsCompleted == 1000000000007ULL );
+    REQUIRE( rov.getRow() == 14 );
+    REQUIRE( rov.getCol() == 14 );
+    REQUIRE( rov.getDir() == NORTH );
+
+    // A diagonal that does cross it reports the failing pass and command
+    Rover blocked = Rover(400, 0, NORTH, grid);
+    result = blocked.tryRepeat("FRFL", 1000000000000ULL);
+    REQUIRE( result.move.status == MOVE_BLOCKED );
+    REQUIRE( result.repetitionsCompleted == 99 );
+    REQUIRE( result.move.commandsConsumed == 2 );
+    REQUIRE( blocked.getRow() == 500 );
+    REQUIRE( blocked.getCol() == 99 );
+    REQUIRE_THROWS_WITH(Rover(0, 0, NORTH, grid).repeat("FZ", 5), "Invalid movement");
+}
+
+// Testing Fleet class
+TEST_CASE( "Fleet lockstep movement matches individual rovers", "[fleet]" ) {
+    std::mt19937 random(3);
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(17, 23);
+    for (int i = 0; i < 60; i++) {
+        grid->putObstacle(random() % 17, random() % 23);
+    }
+
+    Fleet fleet = Fleet(grid);
+    std::vector<Rover> rovers;
+    while (fleet.size() < 200) {
+        int row = random() % 17;
+        int col = random() % 23;
+        Direction dir = (Direction) (random() % 4);
+        if (grid->isValidLocation(row, col)) {
+            REQUIRE( fleet.addRover(row, col, dir) == rovers.size() );
+            rovers.push_back(Rover(row, col, dir, grid));
+        }
+    }
+    REQUIRE_THROWS_AS(fleet.addRover(17, 0, NORTH), std::runtime_error);
+
+    const char commands[] = "FFBLRX";
+    std::string tick(rovers.size(), 'F');
+    std::vector<MoveStatus> statuses(rovers.size());
+    for (int round = 0; round < 100; round++) {
+        for (char& command : tick) {
+            command = commands[random() % 6];
+        }
+        fleet.step(tick.data(), statuses.data());
+        for (size_t i = 0; i < rovers.size(); i++) {
+            MoveResult expected = rovers[i].tryMove(tick[i]);
+            REQUIRE( statuses[i] == expected.status );
+            REQUIRE( fleet.getRow(i) == rovers[i].getRow() );
+            REQUIRE( fleet.getCol(i) == rovers[i].getCol() );
+            REQUIRE( fleet.getDir(i) == rovers[i].getDir() );
+        }
+    }
+
+    // Whole tapes per rover
+    std::vector<std::string> tapes(rovers.size());
+    for (std::string& tape : tapes) {
+        for (int i = 0; i < 50; i++) {
+            tape += commands[random() % 5];
+        }
+    }
+    tapes[0] += "X";
+    std::vector<MoveResult> results = fleet.move(tapes);
+    for (size_t i = 0; i < rovers.size(); i++) {
+        MoveResult expected = rovers[i].tryMove(tapes[i]);
+        REQUIRE( results[i].status == expected.status );
+        REQUIRE( results[i].commandsConsumed == expected.commandsConsumed );
+        REQUIRE( results[i].blockedRow == expected.blockedRow );
+        REQUIRE( results[i].blockedCol == expected.blockedCol );
+        REQUIRE( fleet.getRow(i) == rovers[i].getRow() );
+        REQUIRE( fleet.getCol(i) == rovers[i].getCol() );
+        REQUIRE( fleet.getDir(i) == rovers[i].getDir() );
+    }
+}
+
+TEST_CASE( "Fleet SIMD kernels match individual rovers", "[fleet]" ) {
+    std::mt19937 random(9);
+    const char commands[] = "FFFBLRX";
+    // Column counts either side of a 32-bit word boundary
+    for (int numCols : { 5, 33, 64, 97 }) {
+        std::shared_ptr<Grid> grid = std::make_shared<Grid>(19, numCols);
+        for (int i = 0; i < 2 * numCols; i++) {
+            grid->putObstacle(random() % 19, random() % numCols);
+        }
+
+        std::vector<Fleet> fleets;
+        std::vector<StepKernel> kernels;
+        for (StepKernel kernel : { KERNEL_SCALAR, KERNEL_SSE42, KERNEL_AVX2 }) {
+            if (isStepKernelSupported(kernel)) {
+                fleets.push_back(Fleet(grid));
+                kernels.push_back(kernel);
+            }
+        }
+        std::vector<Rover> rovers;
+        // An odd fleet size exercises the scalar tail of each kernel
+        while (rovers.size() < 203) {
+            int row = random() % 19;
+            int col = random() % numCols;
+            Direction dir = (Direction) (random() % 4);
+            if (grid->isValidLocation(row, col)) {
+                for (Fleet& fleet : fleets) {
+                    fleet.addRover(row, col, dir);
+                }
+                rovers.push_back(Rover(row, col, dir, grid));
+            }
+        }
+
+        std::vector<MoveStatus> statuses(rovers.size());
+        for (int round = 0; round < 200; round++) {
+            char command = commands[random() % 7];
+            std::vector<MoveStatus> expected;
+            for (Rover& rover : rovers) {
+                expected.push_back(rover.tryMove(command).status);
+            }
+            for (size_t k = 0; k < fleets.size(); k++) {
+                fleets[k].stepAll(command, statuses.data(), kernels[k]);
+                for (size_t i = 0; i < rovers.size(); i++) {
+                    REQUIRE( statuses[i] == expected[i] );
+                    REQUIRE( fleets[k].getRow(i) == rovers[i].getRow() );
+                    REQUIRE( fleets[k].getCol(i) == rovers[i].getCol() );
+                    REQUIRE( fleets[k].getDir(i) == rovers[i].getDir() );
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE( "Work-stealing pool runs every index once", "[fleet]" ) {
+    WorkStealingPool pool(4);
+    REQUIRE( pool.getNumThreads() == 4 );
+
+    // Badly skewed work: the first few indices are far slower than the rest
+    std::vector<std::atomic<int>> visits(1000);
+    for (int round = 0; round < 20; round++) {
+        pool.parallelFor(visits.size(), 3, [&](size_t i) {
+            volatile long spin = 0;
+            for (long j = 0; j < (i < 10 ? 20000 : 10); j++) {
+                spin = spin + j;
+            }
+            visits[i]++;
+        });
+    }
+    for (std::atomic<int>& count : visits) {
+        REQUIRE( count.load() == 20 );
+    }
+    pool.parallelFor(0, 1, [](size_t) {});
+}
+
+TEST_CASE( "Fleet parallel tapes match sequential tapes", "[fleet]" ) {
+    std::mt19937 random(21);
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(64, 64);
+    for (int i = 0; i < 200; i++) {
+        grid->putObstacle(random() % 64, random() % 64);
+    }
+    Fleet sequential = Fleet(grid);
+    Fleet parallel = Fleet(grid);
+    std::vector<std::string> tapes;
+    while (sequential.size() < 500) {
+        int row = random() % 64;
+        int col = random() % 64;
+        if (grid->isValidLocation(row, col)) {
+            sequential.addRover(row, col, NORTH);
+            parallel.addRover(row, col, NORTH);
+            // Tape lengths spread over several orders of magnitude
+            std::string tape(1 << (random() % 14), 'F');
+            for (char& command : tape) {
+                command = "FFFBLR"[random() % 6];
+            }
+            tapes.push_back(tape);
+        }
+    }
+
+    WorkStealingPool pool(3);
+    std::vector<MoveResult> expected = sequential.move(tapes);
+    std::vector<MoveResult> actual = parallel.move(tapes, pool, 4);
+    for (size_t i = 0; i < tapes.size(); i++) {
+        REQUIRE( actual[i].status == expected[i].status );
+        REQUIRE( actual[i].commandsConsumed == expected[i].commandsConsumed );
+        REQUIRE( parallel.getRow(i) == sequential.getRow(i) );
+        REQUIRE( parallel.getCol(i) == sequential.getCol(i) );
+        REQUIRE( parallel.getDir(i) == sequential.getDir(i) );
+    }
+}
+
+TEST_CASE( "Fleet tapes must not outnumber its rovers", "[fleet]" ) {
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(8, 8);
+    Fleet fleet = Fleet(grid);
+    fleet.addRover(0, 0, NORTH);
+    fleet.addRover(4, 4, EAST);
+    std::vector<std::string> tapes(3, "FF");
+    std::vector<CommandText> borrowed(tapes.begin(), tapes.end());
+    std::vector<PackedTape> packed(3, PackedTape("FF"));
+    WorkStealingPool pool(2);
+
+    REQUIRE_THROWS_AS(fleet.move(tapes), std::invalid_argument);
+    REQUIRE_THROWS_AS(fleet.move(tapes, pool), std::invalid_argument);
+    REQUIRE_THROWS_AS(fleet.move(borrowed.data(), borrowed.size()), std::invalid_argument);
+    REQUIRE_THROWS_AS(fleet.move(packed), std::invalid_argument);
+    REQUIRE_THROWS_AS(fleet.move(packed, pool), std::invalid_argument);
+
+    // Rovers that avoid each other check the count before stepping in lockstep
+    grid->enableRoverOccupancy();
+    Fleet avoiding = Fleet(grid);
+    avoiding.addRover(0, 0, NORTH);
+    REQUIRE_THROWS_AS(avoiding.move(tapes), std::invalid_argument);
+    REQUIRE_THROWS_AS(avoiding.move(packed, pool), std::invalid_argument);
+    REQUIRE( avoiding.getRow(0) == 0 );
+
+    // Fewer tapes than rovers is fine, the rest stay put
+    tapes.resize(1);
+    std::vector<MoveResult> results = fleet.move(tapes);
+    REQUIRE( results.size() == 1 );
+    REQUIRE( fleet.getRow(0) == 2 );
+    REQUIRE( fleet.getCol(1) == 4 );
+}
+
+// Testing rover occupancy
+TEST_CASE( "Rovers treat each other as obstacles", "[occupancy]" ) {
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(4, 4);
+    grid->enableRoverOccupancy();
+
+    Rover first = Rover(0, 0, NORTH, grid);
+    REQUIRE_THROWS_AS(Rover(0, 0, EAST, grid), std::runtime_error);
+    Rover second = Rover(2, 0, SOUTH, grid);
+
+    MoveResult result = second.tryMove("FF");
+    REQUIRE( result.status == MOVE_BLOCKED_BY_ROVER );
+    REQUIRE( result.commandsConsumed == 1 );
+    REQUIRE( result.blockedRow == 0 );
+    REQUIRE( result.blockedCol == 0 );
+    REQUIRE_THROWS_WITH(first.move('F'), "Rover encountered at: 1, 0");
+
+    // Moving out frees the cell, and a rover that goes away frees its cell too
+    first.move("RF");
+    REQUIRE( second.tryMove('F').status == MOVE_COMPLETED );
+    {
+        Rover passing = Rover(3, 3, NORTH, grid);
+        REQUIRE_THROWS_AS(Rover(passing), std::runtime_error);
+        Rover moved = std::move(passing);
+        REQUIRE( grid->getOccupancy()->isOccupied(3, 3) );
+    }
+    REQUIRE( !grid->getOccupancy()->isOccupied(3, 3) );
+
+    // Compiled runs and repeats stop at other rovers as well
+    Rover runner = Rover(0, 3, WEST, grid);
+    result = runner.tryMove(CompiledTape("FFFF"));
+    REQUIRE( result.status == MOVE_BLOCKED_BY_ROVER );
+    REQUIRE( runner.getCol() == 2 );
+    // Skipping ahead moves the rover's claim to where it ends up
+    RepeatResult repeated = runner.tryRepeat("LFRF", 1000001);
+    REQUIRE( repeated.move.status == MOVE_COMPLETED );
+    REQUIRE( runner.getRow() == 3 );
+    REQUIRE( runner.getCol() == 1 );
+    REQUIRE( grid->getOccupancy()->isOccupied(3, 1) );
+    REQUIRE( !grid->getOccupancy()->isOccupied(0, 2) );
+    repeated = runner.tryRepeat("LB", 1000000);
+    REQUIRE( repeated.move.status == MOVE_BLOCKED_BY_ROVER );
+    REQUIRE( repeated.repetitionsCompleted == 0 );
+    REQUIRE( repeated.move.blockedRow == 0 );
+    REQUIRE( repeated.move.blockedCol == 1 );
+}
+
+TEST_CASE( "Skipped repeats never end on another rover's cell", "[occupancy]" ) {
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(8, 8);
+    grid->enableRoverOccupancy();
+    OccupancyLayer* occupancy = grid->getOccupancy();
+    Rover ghost = Rover(0, 0, NORTH, std::make_shared<Grid>(8, 8));
+    ghost.repeat("FRFL", 1000003);
+    int targetRow = ghost.getRow();
+    int targetCol = ghost.getCol();
+
+    // A rover parked on the skip target stops the repeat right in front of it
+    RepeatResult repeated;
+    {
+        Rover runner = Rover(0, 0, NORTH, grid);
+        {
+            Rover parked = Rover(targetRow, targetCol, SOUTH, grid);
+            repeated = runner.tryRepeat("FRFL", 1000003);
+            REQUIRE( repeated.move.status == MOVE_BLOCKED_BY_ROVER );
+            REQUIRE( repeated.repetitionsCompleted < 1000003 );
+            REQUIRE( repeated.move.blockedRow == targetRow );
+            REQUIRE( repeated.move.blockedCol == targetCol );
+            REQUIRE( (runner.getRow() != targetRow || runner.getCol() != targetCol) );
+            REQUIRE( occupancy->isOccupied(runner.getRow(), runner.getCol()) );
+            REQUIRE( occupancy->isOccupied(targetRow, targetCol) );
+        }
+        runner = Rover(0, 0, NORTH, grid);
+        repeated = runner.tryRepeat("FRFL", 1000003);
+        REQUIRE( repeated.move.status == MOVE_COMPLETED );
+        REQUIRE( runner.getRow() == targetRow );
+        REQUIRE( runner.getCol() == targetCol );
+    }
+    REQUIRE( !occupancy->isOccupied(targetRow, targetCol) );
+
+    // A rover parking there after the passes went through it must not end up
+    // sharing the cell: the racer leaves its start, passes column 3, and then
+    // walks the rest of the strip while the parker takes column 3 behind it
+    std::shared_ptr<Grid> strip = std::make_shared<Grid>(1, 4096);
+    strip->enableRoverOccupancy();
+    OccupancyLayer* stripOccupancy = strip->getOccupancy();
+    ghost = Rover(0, 0, EAST, std::make_shared<Grid>(1, 4096));
+    ghost.repeat("F", 4096 * 1000 + 3);
+    REQUIRE( ghost.getCol() == 3 );
+    for (int attempt = 0; attempt < 20; attempt++) {
+        Rover racer = Rover(0, 0, EAST, strip);
+        uint32_t parkedId = stripOccupancy->newRoverId();
+        std::atomic<bool> isReady(false);
+        std::atomic<bool> isDone(false);
+        std::atomic<bool> isParked(false);
+        std::thread parker([&]() {
+            isReady.store(true);
+            while (!isDone.load() && stripOccupancy->isOccupied(0, 0)) {
+            }
+            while (!isDone.load() && !isParked.load()) {
+                isParked.store(stripOccupancy->tryOccupy(0, 3, parkedId));
+            }
+        });
+        while (!isReady.load()) {
+        }
+        repeated = racer.tryRepeat("F", 4096 * 1000 + 3);
+        isDone.store(true);
+        parker.join();
+        bool isAtTarget = racer.getCol() == 3;
+        REQUIRE( !(isParked.load() && isAtTarget) );
+        REQUIRE( (repeated.move.status == MOVE_COMPLETED) == isAtTarget );
+        REQUIRE( stripOccupancy->isOccupied(0, racer.getCol()) );
+        stripOccupancy->release(0, 3, parkedId);
+    }
+}
+
+TEST_CASE( "Fleet step conflicts resolve by rover id", "[occupancy]" ) {
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(5, 5);
+    grid->enableRoverOccupancy();
+    Rover standalone = Rover(4, 4, NORTH, grid);
+
+    Fleet fleet = Fleet(grid);
+    fleet.addRover(1, 2, NORTH);   // moves up into (2, 2)
+    fleet.addRover(3, 2, SOUTH);   // wants (2, 2) too, loses to rover 0
+    fleet.addRover(0, 2, NORTH);   // cannot follow rover 0 into the cell it left
+    fleet.addRover(4, 3, EAST);    // runs into the standalone rover
+    REQUIRE_THROWS_AS(fleet.addRover(4, 4, NORTH), std::runtime_error);
+
+    std::vector<MoveStatus> statuses(fleet.size());
+    fleet.stepAll('F', statuses.data());
+    REQUIRE( statuses[0] == MOVE_COMPLETED );
+    REQUIRE( statuses[1] == MOVE_BLOCKED_BY_ROVER );
+    REQUIRE( statuses[2] == MOVE_BLOCKED_BY_ROVER );
+    REQUIRE( statuses[3] == MOVE_BLOCKED_BY_ROVER );
+    REQUIRE( fleet.getRow(0) == 2 );
+    REQUIRE( fleet.getRow(1) == 3 );
+    REQUIRE( fleet.getRow(2) == 0 );
+    REQUIRE( fleet.getCol(3) == 3 );
+    REQUIRE( standalone.tryMove("LF").status == MOVE_BLOCKED_BY_ROVER );
+}
+
+TEST_CASE( "Simultaneous fleet steps give the cell to the lowest id", "[occupancy]" ) {
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(5, 5);
+    grid->enableRoverOccupancy();
+    Fleet fleet = Fleet(grid);
+    fleet.addRover(1, 2, NORTH);   // wins (2, 2)
+    fleet.addRover(3, 2, SOUTH);   // also bids for (2, 2) with a higher id
+    fleet.addRover(0, 2, NORTH);   // cannot follow into a cell held at the start of the step
+    fleet.addRover(4, 0, EAST);    // unopposed
+
+    WorkStealingPool pool(2);
+    std::vector<MoveStatus> statuses(fleet.size());
+    fleet.step("FFFF", statuses.data(), pool);
+    REQUIRE( statuses[0] == MOVE_COMPLETED );
+    REQUIRE( statuses[1] == MOVE_BLOCKED_BY_ROVER );
+    REQUIRE( statuses[2] == MOVE_BLOCKED_BY_ROVER );
+    REQUIRE( statuses[3] == MOVE_COMPLETED );
+    REQUIRE( fleet.getRow(0) == 2 );
+    REQUIRE( fleet.getRow(1) == 3 );
+    REQUIRE( fleet.getRow(2) == 0 );
+    REQUIRE( fleet.getCol(3) == 1 );
+    REQUIRE( grid->getOccupancy()->getReservation(2, 2) == OccupancyLayer::NO_ROVER );
+}
+
+TEST_CASE( "Simultaneous fleet steps do not depend on thread count", "[occupancy]" ) {
+    std::mt19937 random(17);
+    std::shared_ptr<Grid> firstGrid = std::make_shared<Grid>(30, 30);
+    std::shared_ptr<Grid> secondGrid = std::make_shared<Grid>(30, 30);
+    for (int i = 0; i < 40; i++) {
+        int row = random() % 30;
+        int col = random() % 30;
+        firstGrid->putObstacle(row, col);
+        secondGrid->putObstacle(row, col);
+    }
+    firstGrid->enableRoverOccupancy();
+    secondGrid->enableRoverOccupancy();
+
+    // A crowded planet, so plenty of cells are contested every step
+    Fleet serial = Fleet(firstGrid);
+    Fleet threaded = Fleet(secondGrid);
+    while (serial.size() < 400) {
+        int row = random() % 30;
+        int col = random() % 30;
+        Direction dir = (Direction) (random() % 4);
+        if (firstGrid->isValidLocation(row, col) && !firstGrid->getOccupancy()->isOccupied(row, col)) {
+            serial.addRover(row, col, dir);
+            threaded.addRover(row, col, dir);
+        }
+    }
+
+    WorkStealingPool onePool(1);
+    WorkStealingPool fourPool(4);
+    std::string commands(serial.size(), 'F');
+    std::vector<MoveStatus> serialStatuses(serial.size());
+    std::vector<MoveStatus> threadedStatuses(serial.size());
+    for (int round = 0; round < 50; round++) {
+        for (char& command : commands) {
+            command = "FFBLR"[random() % 5];
+        }
+        serial.step(commands.data(), serialStatuses.data(), onePool);
+        threaded.step(commands.data(), threadedStatuses.data(), fourPool);
+        REQUIRE( serialStatuses == threadedStatuses );
+    }
+
+    for (size_t i = 0; i < serial.size(); i++) {
+        REQUIRE( threaded.getRow(i) == serial.getRow(i) );
+        REQUIRE( threaded.getCol(i) == serial.getCol(i) );
+        REQUIRE( secondGrid->getOccupancy()->isOccupied(threaded.getRow(i), threaded.getCol(i)) );
+    }
+}
+
+TEST_CASE( "Pooled and serial fleets agree on colliding rovers", "[occupancy]" ) {
+    std::mt19937 random(18);
+    std::vector<std::shared_ptr<Grid> > grids;
+    for (int copy = 0; copy < 4; copy++) {
+        grids.push_back(std::make_shared<Grid>(24, 24));
+    }
+    for (int i = 0; i < 30; i++) {
+        int row = random() % 24;
+        int col = random() % 24;
+        for (std::shared_ptr<Grid>& grid : grids) {
+            grid->putObstacle(row, col);
+        }
+    }
+    std::vector<Fleet> fleets;
+    for (std::shared_ptr<Grid>& grid : grids) {
+        grid->enableRoverOccupancy();
+        fleets.push_back(Fleet(grid));
+    }
+    // Rovers packed into neighbouring cells collide and follow each other every step
+    while (fleets[0].size() < 300) {
+        int row = random() % 24;
+        int col = random() % 24;
+        Direction dir = (Direction) (random() % 4);
+        if (grids[0]->isValidLocation(row, col) && !grids[0]->getOccupancy()->isOccupied(row, col)) {
+            for (Fleet& fleet : fleets) {
+                fleet.addRover(row, col, dir);
+            }
+        }
+    }
+
+    WorkStealingPool pool(4);
+    std::string commands(fleets[0].size(), 'F');
+    std::vector<MoveStatus> serialStatuses(commands.size());
+    std::vector<MoveStatus> pooledStatuses(commands.size());
+    for (int round = 0; round < 40; round++) {
+        for (char& command : commands) {
+            command = "FFFBLR"[random() % 6];
+        }
+        fleets[0].step(commands.data(), serialStatuses.data());
+        fleets[1].step(commands.data(), pooledStatuses.data(), pool);
+        REQUIRE( pooledStatuses == serialStatuses );
+        fleets[2].step(PackedTape(commands), pooledStatuses.data());
+        REQUIRE( pooledStatuses == serialStatuses );
+        fleets[3].step(PackedTape(commands), pooledStatuses.data(), pool);
+        REQUIRE( pooledStatuses == serialStatuses );
+    }
+
+    // Whole tapes run in lockstep, so pooled runs match serial ones too
+    std::vector<std::string> tapes;
+    std::vector<PackedTape> packedTapes;
+    for (size_t rover = 0; rover < fleets[0].size(); rover++) {
+        std::string tape(random() % 200, 'F');
+        for (char& command : tape) {
+            command = "FFFBLR"[random() % 6];
+        }
+        tapes.push_back(tape);
+        packedTapes.push_back(PackedTape(tape));
+    }
+    std::vector<std::vector<MoveResult> > results;
+    results.push_back(fleets[0].move(tapes));
+    results.push_back(fleets[1].move(tapes, pool, 7));
+    results.push_back(fleets[2].move(packedTapes));
+    results.push_back(fleets[3].move(packedTapes, pool));
+    for (size_t copy = 1; copy < fleets.size(); copy++) {
+        for (size_t rover = 0; rover < tapes.size(); rover++) {
+            REQUIRE( results[copy][rover].status == results[0][rover].status );
+            REQUIRE( results[copy][rover].commandsConsumed == results[0][rover].commandsConsumed );
+            REQUIRE( results[copy][rover].blockedRow == results[0][rover].blockedRow );
+            REQUIRE( results[copy][rover].blockedCol == results[0][rover].blockedCol );
+            REQUIRE( fleets[copy].getRow(rover) == fleets[0].getRow(rover) );
+            REQUIRE( fleets[copy].getCol(rover) == fleets[0].getCol(rover) );
+            REQUIRE( fleets[copy].getDir(rover) == fleets[0].getDir(rover) );
+        }
+    }
+
+    // Some tapes really were cut short by other rovers
+    size_t numBlockedByRovers = 0;
+    for (size_t rover = 0; rover < tapes.size(); rover++) {
+        numBlockedByRovers += results[0][rover].status == MOVE_BLOCKED_BY_ROVER;
+        REQUIRE( grids[0]->getOccupancy()->getOwner(fleets[0].getRow(rover), fleets[0].getCol(rover)) != OccupancyLayer::NO_ROVER );
+    }
+    REQUIRE( numBlockedByRovers > 0 );
+}
+
+TEST_CASE( "Rovers on separate threads never share a cell", "[occupancy]" ) {
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(6, 6);
+    grid->enableRoverOccupancy();
+    std::vector<Rover> rovers;
+    for (int i = 0; i < 8; i++) {
+        rovers.push_back(Rover(i % 6, i / 6 * 3, NORTH, grid));
+    }
+
+    runInParallel(rovers.size(), [&](size_t i) {
+        std::mt19937 random((unsigned) i);
+        for (int step = 0; step < 20000; step++) {
+            rovers[i].tryMove("FFBLR"[random() % 5]);
+        }
+    });
+
+    for (size_t i = 0; i < rovers.size(); i++) {
+        for (size_t j = i + 1; j < rovers.size(); j++) {
+            bool isSameCell = rovers[i].getRow() == rovers[j].getRow() && rovers[i].getCol() == rovers[j].getCol();
+            REQUIRE( !isSameCell );
+        }
+        REQUIRE( grid->getOccupancy()->isOccupied(rovers[i].getRow(), rovers[i].getCol()) );
+    }
+}
+
+TEST_CASE( "Tiled grid only allocates tiles holding obstacles", "[tiled]" ) {
+    // A million by a million cells would take 125 GB as one bitset
+    std::shared_ptr<TiledGrid> grid = std::make_shared<TiledGrid>(1000000, 1000000);
+    REQUIRE( grid->getStorage().getNumAllocatedTiles() == 0 );
+    grid->putObstacle(999999, 5);
+    grid->putObstacle(999999, 6);
+    grid->putObstacle(0, 999999);
+    REQUIRE( grid->getStorage().getNumAllocatedTiles() == 2 );
+    REQUIRE( grid->getNumObstacles() == 3 );
+
+    // Runs wrap around the planet and cross into unallocated tiles
+    TiledRover rov = TiledRover(3, 5, NORTH, grid);
+    MoveResult result = rov.tryMove(CompiledTape(std::string(2000000, 'B')));
+    REQUIRE( result.status == MOVE_BLOCKED );
+    REQUIRE( result.commandsConsumed == 3 );
+    REQUIRE( rov.getRow() == 0 );
+    REQUIRE_THROWS_WITH(rov.move("LFFFFFF"), "Obstacle encountered at: 0, 999999");
+
+    // Copies own their tiles
+    TiledGrid copy = *grid;
+    copy.putObstacle(500000, 500000);
+    REQUIRE( copy.getStorage().getNumAllocatedTiles() == 3 );
+    REQUIRE( grid->getStorage().getNumAllocatedTiles() == 2 );
+    REQUIRE( !copy.isValidLocation(999999, 6) );
+    REQUIRE( grid->isValidLocation(500000, 500000) );
+}
+
+TEST_CASE( "Rover occupancy on a huge planet only allocates visited tiles", "[occupancy]" ) {
+    std::shared_ptr<TiledGrid> grid = std::make_shared<TiledGrid>(1000000, 1000000);
+    grid->putObstacle(999999, 3);
+    grid->enableRoverOccupancy();
+    OccupancyLayer* occupancy = grid->getOccupancy();
+    REQUIRE( occupancy->getNumAllocatedTiles() == 0 );
+    REQUIRE( !occupancy->isOccupied(500000, 500000) );
+    REQUIRE( occupancy->getReservation(500000, 500000) == OccupancyLayer::NO_ROVER );
+    REQUIRE( occupancy->getNumAllocatedTiles() == 0 );
+
+    TiledRover first = TiledRover(0, 0, SOUTH, grid);
+    TiledRover second = TiledRover(999998, 0, NORTH, grid);
+    REQUIRE( occupancy->getNumAllocatedTiles() == 2 );
+
+    // Wrapping around the planet crosses into a new tile and meets the other rover
+    MoveResult result = first.tryMove("FF");
+    REQUIRE( result.status == MOVE_BLOCKED_BY_ROVER );
+    REQUIRE( result.blockedRow == 999998 );
+    REQUIRE( first.getRow() == 999999 );
+    REQUIRE( occupancy->getNumAllocatedTiles() == 2 );
+    REQUIRE( occupancy->isOccupied(999999, 0) );
+    REQUIRE( !occupancy->isOccupied(0, 0) );
+
+    std::shared_ptr<SparseGrid> sparse = std::make_shared<SparseGrid>(1000000, 1000000);
+    sparse->enableRoverOccupancy();
+    SparseRover far = SparseRover(123456, 654321, EAST, sparse);
+    REQUIRE( far.tryMove("FFFF").status == MOVE_COMPLETED );
+    REQUIRE( sparse->getOccupancy()->getOwner(123456, 654325) != OccupancyLayer::NO_ROVER );
+    REQUIRE( sparse->getOccupancy()->getNumAllocatedTiles() == 1 );
+}
+
+/**
+ * Checks that rovers on the given grid type move exactly like rovers on a
+ * dense grid holding the same random obstacles
+ **/
+template <class GridType>
+void checkStorageAgainstDense(unsigned seed) {
+    std::mt19937 random(seed);
+    const char commands[] = "FFFFFBBLRX";
+    for (int trial = 0; trial < 200; trial++) {
+        int numRows = 1 + random() % 300;
+        int numCols = 1 + random() % 300;
+        std::shared_ptr<Grid> dense = std::make_shared<Grid>(numRows, numCols);
+        std::shared_ptr<GridType> grid = std::make_shared<GridType>(numRows, numCols);
+        int numObstacles = random() % (numRows + numCols);
+        for (int i = 0; i < numObstacles; i++) {
+            int row = random() % numRows;
+            int col = random() % numCols;
+            dense->putObstacle(row, col);
+            grid->putObstacle(row, col);
+        }
+
+        std::string movements;
+        while (movements.size() < 600) {
+            movements.append(1 + random() % 300, commands[random() % 10]);
+        }
+
+        int row = random() % numRows;
+        int col = random() % numCols;
+        if (!dense->isValidLocation(row, col)) {
+            REQUIRE( !grid->isValidLocation(row, col) );
+            continue;
+        }
+        Direction dir = (Direction) (random() % 4);
+        Rover denseRover = Rover(row, col, dir, dense);
+        BasicRover<GridType> rover = BasicRover<GridType>(row, col, dir, grid);
+        MoveResult expected = denseRover.tryMove(CompiledTape(movements));
+        MoveResult actual = rover.tryMove(CompiledTape(movements));
+        REQUIRE( actual.status == expected.status );
+        REQUIRE( actual.commandsConsumed == expected.commandsConsumed );
+        REQUIRE( actual.row == expected.row );
+        REQUIRE( actual.col == expected.col );
+        REQUIRE( actual.dir == expected.dir );
+    }
+}
+
+TEST_CASE( "Tiled and sparse grids match dense grid", "[tiled][sparse]" ) {
+    checkStorageAgainstDense<TiledGrid>(12);
+    checkStorageAgainstDense<SparseGrid>(13);
+}
 
-// Testing Rover class
-TEST_CASE( "Rover Construction Test", "[rover]" ) {
-    Rover rov = Rover(1, 4, NORTH, Grid(5, 5));
-    REQUIRE( rov.getRow() == 1 );
-    REQUIRE( rov.getCol() == 4 );
+TEST_CASE( "Sparse grid holds a planet of 10^12 cells", "[sparse]" ) {
+    std::shared_ptr<SparseGrid> grid = std::make_shared<SparseGrid>(1000000, 1000000);
+    std::mt19937 random(14);
+    for (int i = 0; i < 10000; i++) {
+        grid->putObstacle(random() % 1000000, random() % 1000000);
+    }
+    grid->putObstacle(12, 999990);
+    grid->putObstacle(12, 999990);
+    REQUIRE( grid->getNumObstacles() >= 10001 );
+    REQUIRE( grid->getStorage().getCapacity() <= 32768 );
+    REQUIRE( !grid->isValidLocation(12, 999990) );
+
+    // Wraps off the west edge straight into the obstacle
+    SparseRover rov = SparseRover(12, 3, WEST, grid);
+    MoveResult result = rov.tryMove(CompiledTape(std::string(50, 'F')));
+    REQUIRE( result.status == MOVE_BLOCKED );
+    REQUIRE( result.commandsConsumed == 12 );
+    REQUIRE( rov.getCol() == 999991 );
 }
 
-TEST_CASE( "Rover Invalid Construction Test", "[rover]" ) {
-    // Rover would not fit on this grid
-    REQUIRE_THROWS_AS(Rover(1, 4, NORTH, Grid(1, 1)), std::runtime_error);
+/**
+ * Checks that the compiled, repeated and parallel paths of a rover agree with
+ * plain per-command stepping on random maps of the given grid type
+ **/
+template <class GridType>
+void checkTopologyAgainstStepping(unsigned seed) {
+    std::mt19937 random(seed);
+    const char commands[] = "FFFFFBBLR";
+    for (int trial = 0; trial < 200; trial++) {
+        int numRows = 1 + random() % 90;
+        int numCols = 1 + random() % 90;
+        std::shared_ptr<GridType> grid = std::make_shared<GridType>(numRows, numCols);
+        int numObstacles = random() % (numRows + numCols) / (1 + trial % 3);
+        for (int i = 0; i < numObstacles; i++) {
+            grid->putObstacle(random() % numRows, random() % numCols);
+        }
+        int row = random() % numRows;
+        int col = random() % numCols;
+        if (!grid->isValidLocation(row, col)) {
+            continue;
+        }
+        Direction dir = (Direction) (random() % 4);
 
-    // Nor this one
-    REQUIRE_THROWS_AS(Rover(0, 4, NORTH, Grid(1, 4)), std::runtime_error);
+        std::string program;
+        int programLength = 1 + random() % 6;
+        for (int i = 0; i < programLength; i++) {
+            program += commands[random() % 9];
+        }
+        size_t repetitions = 1 + random() % 40;
+        std::string movements;
+        for (size_t pass = 0; pass < repetitions; pass++) {
+            movements += program;
+        }
+
+        BasicRover<GridType> stepped = BasicRover<GridType>(row, col, dir, grid);
+        MoveStatus expectedStatus = MOVE_COMPLETED;
+        size_t expectedConsumed = 0;
+        for (char movement : movements) {
+            expectedStatus = stepped.tryMove(movement).status;
+            if (expectedStatus != MOVE_COMPLETED) {
+                break;
+            }
+            expectedConsumed++;
+        }
+
+        BasicRover<GridType> compiled = BasicRover<GridType>(row, col, dir, grid);
+        MoveResult actual = compiled.tryMove(CompiledTape(movements));
+        REQUIRE( actual.status == expectedStatus );
+        REQUIRE( actual.commandsConsumed == expectedConsumed );
+        REQUIRE( compiled.getRow() == stepped.getRow() );
+        REQUIRE( compiled.getCol() == stepped.getCol() );
+        REQUIRE( compiled.getDir() == stepped.getDir() );
+
+        BasicRover<GridType> repeated = BasicRover<GridType>(row, col, dir, grid);
+        RepeatResult repeatResult = repeated.tryRepeat(program, repetitions);
+        REQUIRE( repeatResult.move.status == expectedStatus );
+        REQUIRE( repeated.getRow() == stepped.getRow() );
+        REQUIRE( repeated.getCol() == stepped.getCol() );
+        REQUIRE( repeated.getDir() == stepped.getDir() );
+    }
 }
 
-// Rover Movement TESTS
-TEST_CASE( "Rover basic movement Test", "[rover]" ) {
-    Rover rov = Rover(0, 0, NORTH, Grid(4, 4));
+TEST_CASE( "Grid topologies", "[topology]" ) {
+    typedef BasicGrid<DenseBitsetStorage, BoundedPlaneTopology> PlaneGrid;
+    typedef BasicGrid<SparseObstacleStorage, CylinderTopology> CylinderGrid;
 
-    rov.move('F');
-    // Rover should now be at 1, 0
-    REQUIRE( rov.getRow() == 1 );
-    REQUIRE( rov.getCol() == 0 );
+    // Walls on every edge of a bounded plane
+    BasicRover<PlaneGrid> plane = BasicRover<PlaneGrid>(3, 0, NORTH, PlaneGrid(4, 4));
+    REQUIRE_THROWS_WITH(plane.move('F'), "Obstacle encountered at: 4, 0");
+    MoveResult result = plane.tryMove(CompiledTape("LLFFFFFFF"));
+    REQUIRE( result.status == MOVE_BLOCKED );
+    REQUIRE( result.commandsConsumed == 5 );
+    REQUIRE( plane.getRow() == 0 );
+    REQUIRE( result.blockedRow == -1 );
 
-    rov.move('B');
-    // Rover should now be at 0, 0
-    REQUIRE( rov.getRow() == 0 );
-    REQUIRE( rov.getCol() == 0 );
+    // A cylinder wraps east-west but not over the poles
+    BasicRover<CylinderGrid> cylinder = BasicRover<CylinderGrid>(0, 3, EAST, CylinderGrid(4, 4));
+    cylinder.move("FF");
+    REQUIRE( cylinder.getCol() == 1 );
+    REQUIRE( cylinder.tryRepeat("F", 1000000000000ULL).move.status == MOVE_COMPLETED );
+    REQUIRE( cylinder.getCol() == 1 );
+    RepeatResult polar = cylinder.tryRepeat("RF", 1000000000000ULL);
+    REQUIRE( polar.move.status == MOVE_BLOCKED );
+    REQUIRE( polar.repetitionsCompleted == 0 );
 
-    // Should wrap back to zero
-    rov.move('F');
-    rov.move('F');
-    rov.move('F');
-    rov.move('F');
-    REQUIRE( rov.getRow() == 0 );
-    REQUIRE( rov.getCol() == 0 );
+    checkTopologyAgainstStepping<BasicGrid<DenseBitsetStorage, TorusTopology> >(21);
+    checkTopologyAgainstStepping<PlaneGrid>(22);
+    checkTopologyAgainstStepping<BasicGrid<TiledBitsetStorage, BoundedPlaneTopology> >(23);
+    checkTopologyAgainstStepping<CylinderGrid>(24);
+    checkTopologyAgainstStepping<BasicGrid<DenseBitsetStorage, CylinderTopology> >(25);
 }
 
-TEST_CASE( "Rover basic obstacle movement Test", "[rover]" ) {
-    Grid grid = Grid(4,4);
-    // Place obstacles
-    grid.putObstacle(1,1);
-    grid.putObstacle(2,0);
-    Rover rov = Rover(0, 0, NORTH, grid);
+/**
+ * A uniquely named file in the temporary directory, removed when it goes out of scope
+ * Tests can run in parallel and a failing test cannot leave it behind
+ **/
+class TemporaryFile {
+public:
+    explicit TemporaryFile(const std::string& prefix) {
+        const char* directory = std::getenv("TMPDIR");
+        std::string pattern = std::string(directory && *directory ? directory : "/tmp") + "/" + prefix + "_XXXXXX";
+        std::vector<char> name(pattern.begin(), pattern.end());
+        name.push_back('\0');
+        int fd = mkstemp(name.data());
+        if (fd < 0) {
+            throw std::runtime_error("Cannot create temporary file: " + pattern);
+        }
+        close(fd);
+        this->path = name.data();
+    }
 
-    rov.move('F');
-    // Rover should now be at 1, 0
-    REQUIRE( rov.getRow() == 1 );
-    REQUIRE( rov.getCol() == 0 );
+    TemporaryFile(const TemporaryFile&) = delete;
+    TemporaryFile& operator=(const TemporaryFile&) = delete;
 
-    REQUIRE_THROWS_AS(rov.move('F'), std::runtime_error);
+    ~TemporaryFile() {
+        std::remove(this->path.c_str());
+    }
 
-    // Error when attempting to move right
-    rov.move('R');
-    REQUIRE_THROWS_AS(rov.move('F'), std::runtime_error);
+    const std::string& getPath() const { return this->path; }
+
+private:
+    std::string path;
+};
+
+TEST_CASE( "Grid file round trip", "[gridfile]" ) {
+    TemporaryFile temporary("rover_test_grid");
+    const std::string path = temporary.getPath();
+    std::mt19937 random(15);
+    Grid grid = Grid(150, 333);
+    for (int i = 0; i < 2000; i++) {
+        grid.putObstacle(random() % 150, random() % 333);
+    }
+    writeGridFile(grid, path);
+
+    std::shared_ptr<const MappedGrid> mapped = openGridFile(path);
+    REQUIRE( mapped->getNumRows() == 150 );
+    REQUIRE( mapped->getNumCols() == 333 );
+    REQUIRE( mapped->getNumObstacles() == grid.getNumObstacles() );
+    REQUIRE( (uintptr_t) mapped->getObstacleWords() % GRID_FILE_ALIGNMENT == 0 );
+    REQUIRE( (uintptr_t) mapped->getColWords(0) % GRID_FILE_ALIGNMENT == 0 );
+    for (int row = 0; row < 150; row++) {
+        for (int col = 0; col < 333; col++) {
+            REQUIRE( mapped->isValidLocation(row, col) == grid.isValidLocation(row, col) );
+        }
+    }
+
+    // Rovers on the mapped file behave exactly as on the original grid
+    std::shared_ptr<const Grid> shared = std::make_shared<const Grid>(grid);
+    std::string movements;
+    for (int i = 0; i < 20000; i++) {
+        movements += "FFFFBLR"[random() % 7];
+    }
+    for (int trial = 0; trial < 50; trial++) {
+        int row = random() % 150;
+        int col = random() % 333;
+        if (!grid.isValidLocation(row, col)) {
+            continue;
+        }
+        Rover original = Rover(row, col, NORTH, shared);
+        MappedRover reloaded = MappedRover(row, col, NORTH, mapped);
+        MoveResult expected = original.tryMove(CompiledTape(movements));
+        MoveResult actual = reloaded.tryMove(CompiledTape(movements));
+        REQUIRE( actual.status == expected.status );
+        REQUIRE( actual.commandsConsumed == expected.commandsConsumed );
+        REQUIRE( reloaded.getRow() == original.getRow() );
+        REQUIRE( reloaded.getCol() == original.getCol() );
+    }
 }
 
-TEST_CASE( "Rover complicated obstacle movement test", "[rover]" ) {
-    Grid grid = Grid(4,4);
-    grid.putObstacle(1,1);
-    Rover rov = Rover(0, 0, NORTH, grid);
+TEST_CASE( "Grid file rejects bad files", "[gridfile]" ) {
+    TemporaryFile temporary("rover_test_grid");
+    const std::string path = temporary.getPath();
+    REQUIRE_THROWS_AS(openGridFile("no_such_rover_grid.bin"), std::runtime_error);
 
-    rov.move('F');
-    rov.move('R');
-    REQUIRE( rov.getRow() == 1 );
-    REQUIRE( rov.getCol() == 0 );
-    REQUIRE( rov.getDir() == EAST );
+    writeGridFile(Grid(10, 10), path);
+    std::string contents;
+    {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
 
-    REQUIRE_THROWS_AS(rov.move('F'), std::runtime_error);
+    // Truncated
+    std::ofstream(path.c_str(), std::ios::binary).write(contents.data(), contents.size() - 8);
+    REQUIRE_THROWS_WITH(openGridFile(path), "Not a grid file: " + path);
 
-    rov.move('L');
-    rov.move('F');
-    rov.move('R');
-    rov.move('F');
-    rov.move('R');
-    REQUIRE( rov.getRow() == 2 );
-    REQUIRE( rov.getCol() == 1 );
-    REQUIRE( rov.getDir() == SOUTH );
+    // Written by a newer version
+    std::string newer = contents;
+    newer[8] = 2;
+    std::ofstream(path.c_str(), std::ios::binary).write(newer.data(), newer.size());
+    REQUIRE_THROWS_WITH(openGridFile(path), "Not a grid file: " + path);
 
-    REQUIRE_THROWS_AS(rov.move('F'), std::runtime_error);
+    std::ofstream(path.c_str(), std::ios::binary).write(contents.data(), contents.size());
+    REQUIRE( openGridFile(path)->getNumObstacles() == 0 );
+}
 
-    // Wrap around and approach obstancle from other side
-    rov.move('L');
-    rov.move('L');
-    rov.move('F');
-    rov.move('F');
-    REQUIRE( rov.getRow() == 0 );
-    REQUIRE( rov.getCol() == 1 );
-    REQUIRE_THROWS_AS(rov.move('F'), std::runtime_error);
+TEST_CASE( "PBM import and export", "[pbm]" ) {
+    TemporaryFile temporary("rover_test_map");
+    const std::string path = temporary.getPath();
+    {
+        // Odd width, a comment, and set padding bits that must be ignored
+        const char image[] = "P4\n# survey 7\n10 2\n\x80\x40\x00\xff";
+        std::ofstream(path.c_str(), std::ios::binary).write(image, sizeof(image) - 1);
+    }
+    std::shared_ptr<Grid> small = readPbmFile(path);
+    REQUIRE( small->getNumRows() == 2 );
+    REQUIRE( small->getNumCols() == 10 );
+    REQUIRE( small->getNumObstacles() == 4 );
+    REQUIRE( !small->isValidLocation(0, 0) );
+    REQUIRE( !small->isValidLocation(0, 9) );
+    REQUIRE( !small->isValidLocation(1, 8) );
+    REQUIRE( !small->isValidLocation(1, 9) );
+    REQUIRE( small->isValidLocation(0, 8) );
+    REQUIRE( small->getRowWords(1)[0] == 0x300 );
+
+    // Round trip through a file, including the transposed bitset
+    std::mt19937 random(16);
+    Grid grid = Grid(130, 203);
+    for (int i = 0; i < 3000; i++) {
+        grid.putObstacle(random() % 130, random() % 203);
+    }
+    writePbmFile(grid, path);
+    std::shared_ptr<Grid> loaded = readPbmFile(path);
+    REQUIRE( loaded->getNumObstacles() == grid.getNumObstacles() );
+    for (int row = 0; row < 130; row++) {
+        for (int i = 0; i < grid.getWordsPerRow(); i++) {
+            REQUIRE( loaded->getRowWords(row)[i] == grid.getRowWords(row)[i] );
+        }
+    }
+    for (int col = 0; col < 203; col++) {
+        for (int i = 0; i < grid.getWordsPerCol(); i++) {
+            REQUIRE( loaded->getColWords(col)[i] == grid.getColWords(col)[i] );
+        }
+    }
+
+    {
+        std::ofstream(path.c_str(), std::ios::binary) << "P4\n10 2\n\x80";
+    }
+    REQUIRE_THROWS_WITH(readPbmFile(path), "Not a PBM (P4) file: " + path);
 }
 
+TEST_CASE( "Trajectory overlay", "[pbm]" ) {
+    TemporaryFile temporary("rover_test_overlay");
+    const std::string path = temporary.getPath();
+    Grid grid = Grid(3, 4);
+    grid.putObstacle(2, 3);
+    std::vector<std::pair<int, int>> trajectory;
+    trajectory.push_back(std::make_pair(1, 1));
+    trajectory.push_back(std::make_pair(0, 0));
+    trajectory.push_back(std::make_pair(1, 2));
+    writeTrajectoryOverlay(grid, trajectory, path);
 
-TEST_CASE( "Rover basic rotation Test", "[rover]" ) {
-    Rover rov = Rover(0, 0, NORTH, Grid(4, 4));
+    std::string contents;
+    {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    std::string header = "P5\n4 3\n255\n";
+    REQUIRE( contents.size() == header.size() + 12 );
+    REQUIRE( contents.compare(0, header.size(), header) == 0 );
+    const unsigned char* pixels = (const unsigned char*) contents.data() + header.size();
+    REQUIRE( pixels[0] == OVERLAY_TRAJECTORY );
+    REQUIRE( pixels[1] == OVERLAY_FREE );
+    REQUIRE( pixels[5] == OVERLAY_TRAJECTORY );
+    REQUIRE( pixels[6] == OVERLAY_TRAJECTORY );
+    REQUIRE( pixels[11] == OVERLAY_OBSTACLE );
+}
 
-    rov.move('R');
-    REQUIRE( rov.getDir() == EAST );
+/**
+ * Checks that two grids hold exactly the same obstacles
+ **/
+template <class FirstGrid, class SecondGrid>
+void requireSameObstacles(const FirstGrid& first, const SecondGrid& second) {
+    REQUIRE( first.getNumObstacles() == second.getNumObstacles() );
+    for (int row = 0; row < first.getNumRows(); row++) {
+        for (int col = 0; col < first.getNumCols(); col++) {
+            REQUIRE( first.isValidLocation(row, col) == second.isValidLocation(row, col) );
+        }
+    }
+}
 
-    rov.move('L');
-    REQUIRE( rov.getDir() == NORTH );
+TEST_CASE( "Bulk obstacle insertion", "[bulk]" ) {
+    std::mt19937 random(17);
+    std::vector<std::pair<int, int>> cells;
+    for (int i = 0; i < 300000; i++) {
+        // Includes duplicates and cells outside the grid
+        cells.push_back(std::make_pair((int) (random() % 700) - 50, (int) (random() % 650) - 50));
+    }
 
-    rov.move('L');
-    rov.move('L');
-    REQUIRE( rov.getDir() == SOUTH );
+    Grid expected = Grid(600, 600);
+    for (const std::pair<int, int>& cell : cells) {
+        expected.putObstacle(cell.first, cell.second);
+    }
+    Grid serial = Grid(600, 600);
+    serial.putObstacles(cells);
+    Grid parallel = Grid(600, 600);
+    parallel.putObstacles(cells, 4);
+    TiledGrid tiled = TiledGrid(600, 600);
+    tiled.putObstacles(cells, 4);
+    requireSameObstacles(expected, serial);
+    requireSameObstacles(expected, parallel);
+    requireSameObstacles(expected, tiled);
+    for (int col = 0; col < 600; col++) {
+        for (int i = 0; i < expected.getWordsPerCol(); i++) {
+            REQUIRE( parallel.getColWords(col)[i] == expected.getColWords(col)[i] );
+        }
+    }
+}
 
-    // Should wrap back to NORTH
-    rov.move('L');
-    rov.move('L');
-    REQUIRE( rov.getDir() == NORTH );
+TEST_CASE( "Rectangle obstacle insertion", "[bulk]" ) {
+    std::mt19937 random(18);
+    Grid expected = Grid(200, 300);
+    Grid dense = Grid(200, 300);
+    TiledGrid tiled = TiledGrid(200, 300);
+    SparseGrid sparse = SparseGrid(200, 300);
+    for (int i = 0; i < 40; i++) {
+        int firstRow = (int) (random() % 240) - 20;
+        int firstCol = (int) (random() % 340) - 20;
+        int lastRow = firstRow + (int) (random() % 90) - 5;
+        int lastCol = firstCol + (int) (random() % 150) - 5;
+        for (int row = firstRow; row <= lastRow; row++) {
+            for (int col = firstCol; col <= lastCol; col++) {
+                expected.putObstacle(row, col);
+            }
+        }
+        dense.putObstacleRect(firstRow, firstCol, lastRow, lastCol);
+        tiled.putObstacleRect(firstRow, firstCol, lastRow, lastCol);
+        sparse.putObstacleRect(firstRow, firstCol, lastRow, lastCol);
+    }
+    requireSameObstacles(expected, dense);
+    requireSameObstacles(expected, tiled);
+    requireSameObstacles(expected, sparse);
+
+    // Runs stop at the edge of a rectangle in both directions
+    std::shared_ptr<Grid> walled = std::make_shared<Grid>(10, 200);
+    walled->putObstacleRect(0, 70, 9, 130);
+    Rover rov = Rover(4, 0, EAST, walled);
+    MoveResult result = rov.tryMove(CompiledTape("BBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBB"));
+    REQUIRE( result.status == MOVE_BLOCKED );
+    REQUIRE( rov.getCol() == 131 );
 }
 
-TEST_CASE( "Rover String input test", "[rover]" ) {
-    Rover rov = Rover(0, 0, NORTH, Grid(4, 4));
+/**
+ * Places and removes random obstacles on a grid and a reference grid in step
+ **/
+template <class GridType>
+void checkObstacleRemoval(unsigned seed) {
+    std::mt19937 random(seed);
+    Grid expected = Grid(150, 170);
+    std::shared_ptr<GridType> grid = std::make_shared<GridType>(150, 170);
+    for (int i = 0; i < 40000; i++) {
+        int row = random() % 150;
+        int col = random() % 170;
+        if (random() % 3 == 0) {
+            expected.removeObstacle(row, col);
+            grid->removeObstacle(row, col);
+        } else {
+            expected.putObstacle(row, col);
+            grid->putObstacle(row, col);
+        }
+    }
+    requireSameObstacles(expected, *grid);
 
-    rov.move("FFFFFF");
-    REQUIRE( rov.getRow() == 2 );
-    REQUIRE( rov.getCol() == 0 );
+    // Runs see the cells that were cleared
+    std::string movements;
+    for (int i = 0; i < 5000; i++) {
+        movements += "FFFFBLR"[random() % 7];
+    }
+    std::shared_ptr<const Grid> shared = std::make_shared<const Grid>(expected);
+    for (int trial = 0; trial < 30; trial++) {
+        int row = random() % 150;
+        int col = random() % 170;
+        if (!expected.isValidLocation(row, col)) {
+            continue;
+        }
+        Rover reference = Rover(row, col, SOUTH, shared);
+        BasicRover<GridType> rov = BasicRover<GridType>(row, col, SOUTH, grid);
+        MoveResult expectedResult = reference.tryMove(CompiledTape(movements));
+        MoveResult actualResult = rov.tryMove(CompiledTape(movements));
+        REQUIRE( actualResult.status == expectedResult.status );
+        REQUIRE( actualResult.commandsConsumed == expectedResult.commandsConsumed );
+    }
+}
 
-    rov.move("RF");
-    REQUIRE( rov.getRow() == 2 );
-    REQUIRE( rov.getCol() == 1 );
+TEST_CASE( "Obstacle removal", "[dynamic]" ) {
+    checkObstacleRemoval<Grid>(19);
+    checkObstacleRemoval<TiledGrid>(20);
+    checkObstacleRemoval<SparseGrid>(21);
 
-    rov.move("RRLLB");
-    REQUIRE( rov.getRow() == 2 );
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(4, 4);
+    grid->putObstacle(0, 2);
+    Rover rov = Rover(0, 0, EAST, grid);
+    REQUIRE_THROWS_WITH(rov.move("FF"), "Obstacle encountered at: 0, 2");
+    grid->removeObstacle(0, 2);
+    rov.move("FF");
+    REQUIRE( rov.getCol() == 3 );
+}
+
+TEST_CASE( "Grid epochs and dirty tiles", "[dynamic]" ) {
+    Grid grid = Grid(200, 300);
+    REQUIRE( grid.getEpoch() == 0 );
+    grid.putObstacle(5, 5);
+    REQUIRE( grid.getEpoch() == 1 );
+
+    // Nothing changes, so neither does the epoch
+    grid.putObstacle(5, 5);
+    grid.removeObstacle(6, 6);
+    grid.removeObstacle(-1, 6);
+    grid.putObstacleRect(5, 5, 5, 5);
+    REQUIRE( grid.getEpoch() == 1 );
+    REQUIRE( grid.takeDirtyTiles().empty() );
+
+    grid.enableDirtyTracking();
+    grid.removeObstacle(5, 5);
+    grid.putObstacle(199, 299);
+    grid.putObstacleRect(60, 100, 70, 130);
+    REQUIRE( grid.getEpoch() == 4 );
+    REQUIRE( grid.isTileDirty(0, 0) );
+    REQUIRE( grid.isTileDirty(3, 4) );
+    REQUIRE( !grid.isTileDirty(1, 0) );
+
+    std::vector<std::pair<int, int>> dirty = grid.takeDirtyTiles();
+    std::vector<std::pair<int, int>> expected;
+    expected.push_back(std::make_pair(0, 0));
+    expected.push_back(std::make_pair(0, 1));
+    expected.push_back(std::make_pair(0, 2));
+    expected.push_back(std::make_pair(1, 1));
+    expected.push_back(std::make_pair(1, 2));
+    expected.push_back(std::make_pair(3, 4));
+    REQUIRE( dirty == expected );
+    REQUIRE( grid.takeDirtyTiles().empty() );
+    REQUIRE( !grid.isTileDirty(0, 0) );
+}
+
+TEST_CASE( "Tiled grid versions share unchanged tiles", "[versions]" ) {
+    TiledGrid base = TiledGrid(100000, 100000);
+    std::mt19937 random(22);
+    for (int i = 0; i < 2000; i++) {
+        base.putObstacle(random() % 100000, random() % 100000);
+    }
+    size_t baseTiles = base.getStorage().getNumAllocatedTiles();
+    base.putObstacle(640, 640);
+
+    // Thousands of what-if branches, each with one extra rock
+    std::vector<TiledGrid> branches;
+    for (int i = 0; i < 10000; i++) {
+        branches.push_back(base);
+        branches.back().putObstacle(600 + i % 100, 600 + i / 100);
+    }
+    REQUIRE( base.getStorage().getNumAllocatedTiles() == baseTiles + 1 );
+    for (int i = 0; i < 10000; i++) {
+        REQUIRE( !branches[i].isValidLocation(600 + i % 100, 600 + i / 100) );
+        REQUIRE( !branches[i].isValidLocation(640, 640) );
+        REQUIRE( branches[i].getNumObstacles() == base.getNumObstacles() + (i == 4040 ? 0 : 1) );
+    }
+    REQUIRE( base.isValidLocation(600, 600) );
+    REQUIRE( branches[1].isValidLocation(600, 600) );
+
+    // Only the touched tile was copied, everything else is still shared
+    const TiledBitsetStorage& first = branches[0].getStorage();
+    REQUIRE( first.getTile(9, 9) != base.getStorage().getTile(9, 9) );
+    REQUIRE( first.getTile(9, 10) == base.getStorage().getTile(9, 10) );
+    for (int tileRow = 0; tileRow < 1563; tileRow += 97) {
+        for (int tileCol = 0; tileCol < 1563; tileCol += 89) {
+            REQUIRE( first.getTile(tileRow, tileCol) == base.getStorage().getTile(tileRow, tileCol) );
+        }
+    }
+
+    // Removing from a branch copies too, leaving the base alone
+    branches[0].removeObstacle(640, 640);
+    REQUIRE( branches[0].isValidLocation(640, 640) );
+    REQUIRE( !base.isValidLocation(640, 640) );
+}
+
+TEST_CASE( "Old grid versions stay readable while new ones are built", "[versions]" ) {
+    std::shared_ptr<TiledGrid> base = std::make_shared<TiledGrid>(512, 512);
+    for (int i = 0; i < 512; i += 3) {
+        base->putObstacle(i, (i * 7) % 512);
+    }
+    std::string movements;
+    std::mt19937 random(23);
+    for (int i = 0; i < 4000; i++) {
+        movements += "FFFFBLR"[random() % 7];
+    }
+    TiledRover expectedRover = TiledRover(1, 1, NORTH, base);
+    MoveResult expected = expectedRover.tryMove(CompiledTape(movements));
+
+    std::atomic<bool> isBaseUnchanged(true);
+    runInParallel(4, [&](size_t task) {
+        std::mt19937 taskRandom((unsigned) task);
+        for (int version = 0; version < 200; version++) {
+            if (task == 0) {
+                // Readers keep seeing the base map exactly as it was
+                TiledRover rov = TiledRover(1, 1, NORTH, base);
+                MoveResult result = rov.tryMove(CompiledTape(movements));
+                if (result.commandsConsumed != expected.commandsConsumed || rov.getRow() != expectedRover.getRow()) {
+                    isBaseUnchanged = false;
+                }
+            } else {
+                TiledGrid branch = *base;
+                for (int i = 0; i < 50; i++) {
+                    branch.putObstacle(taskRandom() % 512, taskRandom() % 512);
+                }
+            }
+        }
+    });
+    REQUIRE( isBaseUnchanged );
+}
+
+TEST_CASE( "Grid publisher gives readers stable snapshots", "[rcu]" ) {
+    GridPublisher<TiledGrid> publisher(TiledGrid(100, 100), 2);
+    GridPublisher<TiledGrid>::ReadGuard before = publisher.read(0);
+    publisher.update([](TiledGrid& grid) { grid.putObstacle(0, 3); });
+    {
+        GridPublisher<TiledGrid>::ReadGuard after = publisher.read(1);
+        REQUIRE( !after->isValidLocation(0, 3) );
+        REQUIRE( before->isValidLocation(0, 3) );
+
+        // Rovers run against whichever version they were given
+        TiledRover oldRover = TiledRover(0, 0, EAST, before.getGrid());
+        TiledRover newRover = TiledRover(0, 0, EAST, after.getGrid());
+        REQUIRE( oldRover.tryMove("FFFF").status == MOVE_COMPLETED );
+        REQUIRE( newRover.tryMove("FFFF").status == MOVE_BLOCKED );
+    }
+
+    // The first version is kept until its reader lets go
+    REQUIRE( publisher.getNumRetired() == 1 );
+    { GridPublisher<TiledGrid>::ReadGuard released = std::move(before); }
+    REQUIRE( publisher.getNumRetired() == 0 );
+}
+
+TEST_CASE( "Grid publisher under concurrent readers and writers", "[rcu]" ) {
+    // Every update adds a pair of obstacles; a consistent snapshot never holds half a pair
+    GridPublisher<TiledGrid> publisher(TiledGrid(256, 256), 3);
+    std::atomic<bool> isWriting(true);
+    std::atomic<bool> isConsistent(true);
+    std::atomic<int> numReads(0);
+    runInParallel(4, [&](size_t task) {
+        if (task == 0) {
+            for (int i = 0; i < 256; i++) {
+                publisher.update([i](TiledGrid& grid) {
+                    grid.putObstacle(i, 0);
+                    grid.putObstacle(255 - i, 200);
+                });
+            }
+            isWriting = false;
+            return;
+        }
+        while (isWriting || numReads < 100) {
+            GridPublisher<TiledGrid>::ReadGuard grid = publisher.read((unsigned) task - 1);
+            int numPairs = 0;
+            for (int i = 0; i < 256; i++) {
+                if (grid->isValidLocation(i, 0) != grid->isValidLocation(255 - i, 200)) {
+                    isConsistent = false;
+                }
+                numPairs += grid->isValidLocation(i, 0) ? 0 : 1;
+            }
+            if (grid->getNumObstacles() != (size_t) (2 * numPairs)) {
+                isConsistent = false;
+            }
+            numReads++;
+        }
+    });
+    REQUIRE( isConsistent );
+    REQUIRE( publisher.getNumRetired() == 0 );
+    GridPublisher<TiledGrid>::ReadGuard latest = publisher.read(0);
+    REQUIRE( latest->getNumObstacles() == 512 );
+}
+
+/**
+ * Checks that a compile-time grid wraps and steps exactly like a runtime grid
+ * of the same shape and topology
+ **/
+template <class StaticGridType>
+void checkStaticGridAgainstRuntime(unsigned seed) {
+    typedef BasicGrid<typename StaticGridType::Storage, typename StaticGridType::Topology::Base> RuntimeGrid;
+    const int numRows = StaticGridType::Topology::ROWS;
+    const int numCols = StaticGridType::Topology::COLS;
+    std::shared_ptr<StaticGridType> fixed = std::make_shared<StaticGridType>();
+    std::shared_ptr<RuntimeGrid> runtime = std::make_shared<RuntimeGrid>(numRows, numCols);
+    REQUIRE( fixed->getNumRows() == runtime->getNumRows() );
+    REQUIRE( fixed->getNumCols() == runtime->getNumCols() );
+
+    for (int value = -3 * numRows - 2; value <= 3 * numRows + 2; value++) {
+        REQUIRE( fixed->convertToGridRow(value) == runtime->convertToGridRow(value) );
+        if (value >= -numRows && value < 2 * numRows) {
+            REQUIRE( fixed->wrapStepRow(value) == runtime->convertToGridRow(value) );
+            REQUIRE( runtime->wrapStepRow(value) == runtime->convertToGridRow(value) );
+        }
+    }
+    for (int value = -3 * numCols - 2; value <= 3 * numCols + 2; value++) {
+        REQUIRE( fixed->convertToGridCol(value) == runtime->convertToGridCol(value) );
+        if (value >= -numCols && value < 2 * numCols) {
+            REQUIRE( fixed->wrapStepCol(value) == runtime->convertToGridCol(value) );
+            REQUIRE( runtime->wrapStepCol(value) == runtime->convertToGridCol(value) );
+        }
+    }
+
+    std::mt19937 random(seed);
+    int numObstacles = (numRows * numCols) / 8;
+    for (int i = 0; i < numObstacles; i++) {
+        int row = random() % numRows;
+        int col = random() % numCols;
+        fixed->putObstacle(row, col);
+        runtime->putObstacle(row, col);
+    }
+    for (int row = -1; row <= numRows; row++) {
+        for (int col = -1; col <= numCols; col++) {
+            REQUIRE( fixed->isValidLocation(row, col) == runtime->isValidLocation(row, col) );
+        }
+    }
+
+    for (int trial = 0; trial < 50; trial++) {
+        int row = random() % numRows;
+        int col = random() % numCols;
+        if (!runtime->isValidLocation(row, col)) {
+            continue;
+        }
+        Direction dir = (Direction) (random() % 4);
+        BasicRover<StaticGridType> onFixed = BasicRover<StaticGridType>(row, col, dir, fixed);
+        BasicRover<RuntimeGrid> onRuntime = BasicRover<RuntimeGrid>(row, col, dir, runtime);
+        for (int step = 0; step < 500; step++) {
+            char movement = "FFFBLR"[random() % 6];
+            REQUIRE( onFixed.tryMove(movement).status == onRuntime.tryMove(movement).status );
+            REQUIRE( onFixed.getRow() == onRuntime.getRow() );
+            REQUIRE( onFixed.getCol() == onRuntime.getCol() );
+            REQUIRE( onFixed.getDir() == onRuntime.getDir() );
+        }
+    }
+}
+
+TEST_CASE( "Static grids match runtime grids", "[static]" ) {
+    checkStaticGridAgainstRuntime<StaticGrid<64, 64> >(31);
+    checkStaticGridAgainstRuntime<StaticGrid<5, 7> >(32);
+    checkStaticGridAgainstRuntime<StaticGrid<1, 1> >(33);
+    checkStaticGridAgainstRuntime<StaticGrid<16, 12, TiledBitsetStorage, CylinderTopology> >(34);
+    checkStaticGridAgainstRuntime<StaticGrid<8, 9, SparseObstacleStorage, BoundedPlaneTopology> >(35);
+
+    // A power-of-two rover walks off the south-west corner and comes back on the far side
+    std::shared_ptr<StaticGrid<1024, 1024> > planet = std::make_shared<StaticGrid<1024, 1024> >();
+    BasicRover<StaticGrid<1024, 1024> > rover = BasicRover<StaticGrid<1024, 1024> >(0, 0, SOUTH, planet);
+    rover.move("FRF");
+    REQUIRE( rover.getRow() == 1023 );
+    REQUIRE( rover.getCol() == 1023 );
+    REQUIRE( planet->convertToGridRow(-2147483647 - 1) == 0 );
+
+    // Code written against BasicGrid gets the compile-time dimensions too
+    const BasicGrid<DenseBitsetStorage, StaticTopology<1024, 1024> >& base = *planet;
+    REQUIRE( base.getNumRows() == 1024 );
+    REQUIRE( base.wrapStepCol(-1) == 1023 );
+    REQUIRE( base.convertToGridCol(5000) == 904 );
+    REQUIRE( !base.isInGrid(1024, 0) );
+}
+
+TEST_CASE( "Rover poses pack into one word", "[pose]" ) {
+    RoverPose pose = RoverPose(2147483647, 123456789, WEST);
+    REQUIRE( pose.getRow() == 2147483647 );
+    REQUIRE( pose.getCol() == 123456789 );
+    REQUIRE( pose.getDir() == WEST );
+    pose.setCol(2147483647);
+    pose.setDir(NORTH);
+    pose.setRow(0);
+    REQUIRE( pose.getRow() == 0 );
+    REQUIRE( pose.getCol() == 2147483647 );
+    REQUIRE( pose.getDir() == NORTH );
+
+    // Every direction survives with every coordinate at the extremes
+    const int coordinates[] = { 0, 1, 1000, 2147483646, 2147483647 };
+    for (int row : coordinates) {
+        for (int col : coordinates) {
+            for (int dir = NORTH; dir <= WEST; dir++) {
+                RoverPose packed = RoverPose(row, col, (Direction) dir);
+                REQUIRE( packed.getRow() == row );
+                REQUIRE( packed.getCol() == col );
+                REQUIRE( packed.getDir() == dir );
+            }
+        }
+    }
+
+    // Poses snapshot with memcpy and restore into working rovers
+    std::mt19937 random(41);
+    std::shared_ptr<const Grid> grid = std::make_shared<const Grid>(100, 100);
+    std::vector<Rover> rovers;
+    for (int i = 0; i < 100; i++) {
+        rovers.push_back(Rover(random() % 100, random() % 100, (Direction) (random() % 4), grid));
+    }
+    std::vector<RoverPose> poses(rovers.size());
+    for (size_t i = 0; i < rovers.size(); i++) {
+        poses[i] = rovers[i].getPose();
+    }
+    std::vector<RoverPose> snapshot(poses.size());
+    std::memcpy(snapshot.data(), poses.data(), poses.size() * sizeof(RoverPose));
+    for (size_t i = 0; i < rovers.size(); i++) {
+        rovers[i].move("FFRFFLB");
+    }
+    for (size_t i = 0; i < rovers.size(); i++) {
+        Rover restored = Rover(snapshot[i], grid);
+        restored.move("FFRFFLB");
+        REQUIRE( restored.getPose() == rovers[i].getPose() );
+    }
+}
+
+/**
+ * Reference decoding of one command, written out case by case
+ **/
+CommandStep referenceCommandStep(Direction dir, unsigned char command) {
+    static const Direction leftOf[4] = { WEST, NORTH, EAST, SOUTH };
+    static const Direction rightOf[4] = { EAST, SOUTH, WEST, NORTH };
+    static const int rowSteps[4] = { 1, 0, -1, 0 };
+    static const int colSteps[4] = { 0, 1, 0, -1 };
+    CommandStep step = { 0, 0, (uint8_t) dir, 1 };
+    switch (command) {
+        case 'F': {
+            step.rowStep = (int8_t) rowSteps[dir];
+            step.colStep = (int8_t) colSteps[dir];
+            break;
+        }
+        case 'B': {
+            step.rowStep = (int8_t) -rowSteps[dir];
+            step.colStep = (int8_t) -colSteps[dir];
+            break;
+        }
+        case 'L': {
+            step.dir = (uint8_t) leftOf[dir];
+            break;
+        }
+        case 'R': {
+            step.dir = (uint8_t) rightOf[dir];
+            break;
+        }
+        default: {
+            step.isValid = 0;
+            break;
+        }
+    }
+    return step;
+}
+
+TEST_CASE( "Command table matches the reference decoding", "[decode]" ) {
+    for (int dir = NORTH; dir <= WEST; dir++) {
+        for (int command = 0; command < 256; command++) {
+            CommandStep expected = referenceCommandStep((Direction) dir, (unsigned char) command);
+            const CommandStep& actual = COMMAND_TABLE.decode(dir, (char) command);
+            REQUIRE( actual.rowStep == expected.rowStep );
+            REQUIRE( actual.colStep == expected.colStep );
+            REQUIRE( actual.dir == expected.dir );
+            REQUIRE( actual.isValid == expected.isValid );
+        }
+
+        // Four turns either way come back round, and a left undoes a right
+        Direction heading = (Direction) dir;
+        for (int turn = 0; turn < 4; turn++) {
+            heading = rotateDirection(heading, false);
+        }
+        REQUIRE( heading == dir );
+        REQUIRE( rotateDirection(rotateDirection((Direction) dir, false), true) == dir );
+    }
+
+    // Turning right from WEST faces NORTH on every path
+    std::shared_ptr<const Grid> grid = std::make_shared<const Grid>(10, 10);
+    Rover stepped = Rover(5, 5, WEST, grid);
+    stepped.move('R');
+    REQUIRE( stepped.getDir() == NORTH );
+    Rover compiled = Rover(5, 5, WEST, grid);
+    compiled.tryMove(CompiledTape("RF"));
+    REQUIRE( compiled.getDir() == NORTH );
+    REQUIRE( compiled.getRow() == 6 );
+    Fleet fleet = Fleet(grid);
+    fleet.addRover(5, 5, WEST);
+    MoveStatus status;
+    fleet.stepAll('R', &status, KERNEL_SCALAR);
+    REQUIRE( status == MOVE_COMPLETED );
+    REQUIRE( fleet.getDir(0) == NORTH );
+}
+
+TEST_CASE( "Command validation kernels", "[validate]" ) {
+    std::vector<StepKernel> kernels;
+    for (StepKernel kernel : { KERNEL_SCALAR, KERNEL_SSE42, KERNEL_AVX2 }) {
+        if (isStepKernelSupported(kernel)) {
+            kernels.push_back(kernel);
+        }
+    }
+
+    // Invalid bytes at every offset around the vector block boundaries
+    std::mt19937 random(51);
+    for (size_t length : { 0, 1, 15, 16, 17, 31, 32, 33, 100, 255 * 32 + 7, 255 * 32 * 3 + 40 }) {
+        std::string tape;
+        for (size_t i = 0; i < length; i++) {
+            tape += "FBLR"[random() % 4];
+        }
+        std::vector<size_t> badOffsets = { length };
+        for (size_t offset = 0; offset < std::min<size_t>(length, 70); offset++) {
+            badOffsets.push_back(offset);
+        }
+        if (length > 0) {
+            badOffsets.push_back(length - 1);
+            badOffsets.push_back(random() % length);
+        }
+        for (size_t badOffset : badOffsets) {
+            std::string candidate = tape;
+            if (badOffset < length) {
+                candidate[badOffset] = "fX\0\xC6"[random() % 4];
+            }
+            size_t counts[4] = { 0, 0, 0, 0 };
+            for (size_t i = 0; i < badOffset; i++) {
+                counts[std::string("FBLR").find(candidate[i])]++;
+            }
+            for (StepKernel kernel : kernels) {
+                CommandCounts actual = validateCommands(candidate.data(), candidate.size(), kernel);
+                REQUIRE( actual.firstInvalid == badOffset );
+                REQUIRE( actual.numForward == counts[0] );
+                REQUIRE( actual.numBackward == counts[1] );
+                REQUIRE( actual.numLeft == counts[2] );
+                REQUIRE( actual.numRight == counts[3] );
+            }
+        }
+    }
+
+    // An invalid tape is rejected before the rover moves
+    std::shared_ptr<const Grid> grid = std::make_shared<const Grid>(10, 10);
+    Rover rov = Rover(0, 0, NORTH, grid);
+    REQUIRE_THROWS_WITH(rov.move("FFRFF?F"), "Invalid movement");
+    REQUIRE_THROWS_WITH(rov.repeat("FFRF!", 3), "Invalid movement");
+    REQUIRE( rov.getRow() == 0 );
     REQUIRE( rov.getCol() == 0 );
+    REQUIRE( rov.getDir() == NORTH );
+}
+
+TEST_CASE( "Packed tapes round trip on every kernel", "[packed]" ) {
+    std::vector<StepKernel> kernels;
+    for (StepKernel kernel : { KERNEL_SCALAR, KERNEL_SSE42, KERNEL_AVX2 }) {
+        if (isStepKernelSupported(kernel)) {
+            kernels.push_back(kernel);
+        }
+    }
+
+    std::mt19937 random(61);
+    for (size_t length : { 0, 1, 3, 4, 5, 15, 16, 17, 31, 32, 33, 63, 64, 65, 1000, 4099 }) {
+        std::string movements;
+        for (size_t i = 0; i < length; i++) {
+            movements += "FBLR"[random() % 4];
+        }
+        std::vector<uint8_t> expected((length + 3) / 4, 0);
+        for (size_t i = 0; i < length; i++) {
+            expected[i / 4] |= (uint8_t) (std::string("FBLR").find(movements[i]) << (2 * (i % 4)));
+        }
+        for (StepKernel kernel : kernels) {
+            std::vector<uint8_t> packed((length + 3) / 4, 0xFF);
+            packCommands(movements.data(), length, packed.data(), kernel);
+            REQUIRE( packed == expected );
+            std::string unpacked(length, '?');
+            unpackCommands(packed.data(), length, &unpacked[0], kernel);
+            REQUIRE( unpacked == movements );
+        }
+
+        PackedTape tape = PackedTape(movements);
+        REQUIRE( tape.getNumCommands() == length );
+        REQUIRE( tape.getBytes() == expected );
+        REQUIRE( tape.unpack() == movements );
+        if (length > 0) {
+            REQUIRE( tape.getCommand(length - 1) == movements[length - 1] );
+        }
+    }
+
+    REQUIRE_THROWS_WITH(PackedTape("FFBx"), "Invalid movement");
+    REQUIRE_THROWS_WITH(PackedTape(std::vector<uint8_t>(3), 5), "Packed tape size does not match its command count");
+}
+
+TEST_CASE( "Packed tapes run like command strings", "[packed]" ) {
+    std::mt19937 random(62);
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(97, 61);
+    for (int i = 0; i < 300; i++) {
+        grid->putObstacle(random() % 97, random() % 61);
+    }
+    std::string movements;
+    for (int i = 0; i < 30000; i++) {
+        movements += "FFFFBLR"[random() % 7];
+    }
+    PackedTape tape = PackedTape(movements);
+    CompiledTape compiledFromPacked = CompiledTape(tape);
+    REQUIRE( compiledFromPacked.getNumCommands() == movements.size() );
+
+    for (int trial = 0; trial < 40; trial++) {
+        int row = random() % 97;
+        int col = random() % 61;
+        if (!grid->isValidLocation(row, col)) {
+            continue;
+        }
+        Direction dir = (Direction) (random() % 4);
+        Rover reference = Rover(row, col, dir, grid);
+        MoveResult expected = reference.tryMove(movements);
+
+        Rover packed = Rover(row, col, dir, grid);
+        MoveResult actual = packed.tryMove(tape);
+        REQUIRE( actual.status == expected.status );
+        REQUIRE( actual.commandsConsumed == expected.commandsConsumed );
+        REQUIRE( packed.getPose() == reference.getPose() );
+
+        Rover compiled = Rover(row, col, dir, grid);
+        actual = compiled.tryMove(compiledFromPacked);
+        REQUIRE( actual.status == expected.status );
+        REQUIRE( actual.commandsConsumed == expected.commandsConsumed );
+        REQUIRE( compiled.getPose() == reference.getPose() );
+    }
+
+    // Raw spans run without building a string or a tape first
+    Rover fromSpan = Rover(0, 0, NORTH, std::make_shared<const Grid>(10, 10));
+    const char buffer[] = "xxFFRFFyy";
+    REQUIRE( fromSpan.tryMove(buffer + 2, buffer + 7).status == MOVE_COMPLETED );
+    REQUIRE( fromSpan.getRow() == 2 );
+    REQUIRE( fromSpan.getCol() == 2 );
+    const uint8_t packedForwards[] = { 0x00, 0x00 };
+    REQUIRE( fromSpan.tryMovePacked(packedForwards, 6).commandsConsumed == 6 );
+    REQUIRE( fromSpan.getCol() == 8 );
+}
+
+TEST_CASE( "Packed and borrowed tapes on every execution path", "[packed]" ) {
+    std::mt19937 random(63);
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(211, 157);
+    for (int i = 0; i < 400; i++) {
+        grid->putObstacle(random() % 211, random() % 157);
+    }
+    grid->removeObstacle(0, 0);
+
+    // Borrowed slices of a larger buffer, with no string built for them
+    const char buffer[] = "xxFFRFFyy";
+    CommandText slice = CommandText(buffer + 2, 5);
+    REQUIRE( slice.size() == 5 );
+    REQUIRE( validateCommands(slice).firstInvalid == 5 );
+    Rover fromSlice = Rover(0, 0, NORTH, std::make_shared<const Grid>(10, 10));
+    fromSlice.move(slice);
+    REQUIRE( fromSlice.getRow() == 2 );
+    REQUIRE( fromSlice.getCol() == 2 );
+
+    // Repeating and parallel runs of a packed tape match the string
+    std::string program = "FFRFFLBFLLFR";
+    PackedTape packedProgram = PackedTape(program);
+    REQUIRE( CompiledTape(packedProgram).getOps().size() == CompiledTape(program).getOps().size() );
+    Rover textRepeat = Rover(0, 0, NORTH, grid);
+    Rover packedRepeat = Rover(0, 0, NORTH, grid);
+    RepeatResult textRepeated = textRepeat.tryRepeat(program, 1000003);
+    RepeatResult packedRepeated = packedRepeat.tryRepeat(packedProgram, 1000003);
+    REQUIRE( packedRepeated.repetitionsCompleted == textRepeated.repetitionsCompleted );
+    REQUIRE( packedRepeated.move.status == textRepeated.move.status );
+    REQUIRE( packedRepeated.move.commandsConsumed == textRepeated.move.commandsConsumed );
+    REQUIRE( packedRepeat.getPose() == textRepeat.getPose() );
+
+    std::string movements;
+    for (int i = 0; i < 300001; i++) {
+        movements += "FFFFFBLLR"[random() % 9];
+    }
+    PackedTape tape = PackedTape(movements);
+    std::shared_ptr<Grid> clear = std::make_shared<Grid>(211, 157);
+    for (std::shared_ptr<Grid> planet : { grid, clear }) {
+        Rover reference = Rover(0, 0, EAST, planet);
+        MoveResult expected = reference.tryMove(movements);
+        Rover parallel = Rover(0, 0, EAST, planet);
+        MoveResult actual = parallel.tryMoveParallel(tape, 4);
+        REQUIRE( actual.status == expected.status );
+        REQUIRE( actual.commandsConsumed == expected.commandsConsumed );
+        REQUIRE( parallel.getPose() == reference.getPose() );
+    }
+
+    // Fleets take borrowed and packed tapes, serially and on a pool
+    std::vector<std::string> tapes;
+    std::vector<CommandText> borrowed;
+    std::vector<PackedTape> packedTapes;
+    for (int rover = 0; rover < 64; rover++) {
+        tapes.push_back(movements.substr(rover * 100, 50 + rover * 37));
+    }
+    for (const std::string& text : tapes) {
+        borrowed.push_back(CommandText(text));
+        packedTapes.push_back(PackedTape(text));
+    }
+    WorkStealingPool pool(4);
+    std::vector<Fleet> fleets;
+    for (int copy = 0; copy < 5; copy++) {
+        fleets.push_back(Fleet(clear));
+        for (int rover = 0; rover < 64; rover++) {
+            fleets.back().addRover(rover * 3, rover * 2, (Direction) (rover % 4));
+        }
+    }
+    std::vector<std::vector<MoveResult> > results;
+    results.push_back(fleets[0].move(tapes));
+    results.push_back(fleets[1].move(borrowed.data(), borrowed.size()));
+    results.push_back(fleets[2].move(packedTapes));
+    results.push_back(fleets[3].move(borrowed.data(), borrowed.size(), pool));
+    results.push_back(fleets[4].move(packedTapes, pool));
+    for (size_t copy = 1; copy < results.size(); copy++) {
+        for (int rover = 0; rover < 64; rover++) {
+            REQUIRE( results[copy][rover].status == results[0][rover].status );
+            REQUIRE( results[copy][rover].commandsConsumed == results[0][rover].commandsConsumed );
+            REQUIRE( fleets[copy].getRow(rover) == fleets[0].getRow(rover) );
+            REQUIRE( fleets[copy].getCol(rover) == fleets[0].getCol(rover) );
+            REQUIRE( fleets[copy].getDir(rover) == fleets[0].getDir(rover) );
+        }
+    }
+
+    // A packed step tape holds one command per rover
+    std::string commands = movements.substr(0, 64);
+    PackedTape packedCommands = PackedTape(commands);
+    std::vector<MoveStatus> textStatuses(64);
+    std::vector<MoveStatus> packedStatuses(64);
+    std::vector<MoveStatus> pooledStatuses(64);
+    fleets[0].step(commands.data(), textStatuses.data());
+    fleets[1].step(packedCommands, packedStatuses.data());
+    fleets[2].step(packedCommands, pooledStatuses.data(), pool);
+    REQUIRE( packedStatuses == textStatuses );
+    REQUIRE( pooledStatuses == textStatuses );
+    for (int rover = 0; rover < 64; rover++) {
+        REQUIRE( fleets[1].getRow(rover) == fleets[0].getRow(rover) );
+        REQUIRE( fleets[2].getCol(rover) == fleets[0].getCol(rover) );
+    }
+    REQUIRE_THROWS_WITH(fleets[0].step(PackedTape("FF"), textStatuses.data()), "Packed tape size does not match the fleet size");
+}
+
+TEST_CASE( "Rover handles are plain values", "[pose]" ) {
+    std::mt19937 random(42);
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(83, 59);
+    for (int i = 0; i < 200; i++) {
+        grid->putObstacle(random() % 83, random() % 59);
+    }
+    grid->removeObstacle(5, 5);
+    REQUIRE_THROWS_WITH(RoverHandle(83, 0, NORTH, *grid), "Rover cannot be placed here");
+
+    std::string movements;
+    for (int i = 0; i < 5000; i++) {
+        movements += "FFFBLRx"[random() % (i < 4900 ? 6 : 7)];
+    }
+    PackedTape tape = PackedTape(movements.substr(0, 4900));
+
+    std::vector<Rover> rovers;
+    RoverHandle handles[40];
+    for (int i = 0; i < 40; i++) {
+        int row = random() % 83;
+        int col = random() % 59;
+        if (!grid->isValidLocation(row, col)) {
+            row = 5;
+            col = 5;
+        }
+        rovers.push_back(Rover(row, col, (Direction) (i % 4), grid));
+        handles[i] = rovers.back().getHandle();
+    }
+
+    // Handles snapshot with memcpy and then move exactly like the rovers
+    RoverHandle snapshot[40];
+    std::memcpy(snapshot, handles, sizeof(handles));
+    for (int i = 0; i < 40; i++) {
+        REQUIRE( snapshot[i].getPose() == rovers[i].getPose() );
+        REQUIRE( &snapshot[i].getGrid() == grid.get() );
+
+        Rover reference = Rover(rovers[i].getPose(), grid);
+        MoveResult expected = reference.tryMove(movements);
+        MoveResult actual = snapshot[i].tryMove(movements);
+        REQUIRE( actual.status == expected.status );
+        REQUIRE( actual.commandsConsumed == expected.commandsConsumed );
+        REQUIRE( actual.blockedRow == expected.blockedRow );
+        REQUIRE( snapshot[i].getPose() == reference.getPose() );
+
+        Rover packedReference = Rover(rovers[i].getPose(), grid);
+        expected = packedReference.tryMove(tape);
+        actual = handles[i].tryMove(tape);
+        REQUIRE( actual.status == expected.status );
+        REQUIRE( actual.commandsConsumed == expected.commandsConsumed );
+        REQUIRE( handles[i].getPose() == packedReference.getPose() );
+    }
 }